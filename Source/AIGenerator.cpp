@@ -1,79 +1,569 @@
 #include "AIGenerator.h"
 
+namespace
+{
+    double nowMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    // Returns the offset of the blank line ending the HTTP headers, or -1
+    int findHeaderEnd(const char* data, int size, int searchFrom)
+    {
+        for (int i = juce::jmax(0, searchFrom); i + 3 < size; ++i)
+            if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n')
+                return i;
+
+        return -1;
+    }
+
+    // Rejects what the backend could never accept before any connection is
+    // made; returns an empty string when the request is fine
+    juce::String validateRequest(const juce::String& prompt, float duration, double sampleRate)
+    {
+        if (prompt.trim().isEmpty())
+            return "Prompt cannot be empty";
+
+        if (!std::isfinite(duration) || duration <= 0.0f)
+            return "Invalid duration: " + juce::String(duration);
+
+        if (!std::isfinite(sampleRate) || sampleRate <= 0.0)
+            return "Invalid sample rate: " + juce::String(sampleRate);
+
+        return {};
+    }
+}
+
+juce::String RequestTimings::toString() const
+{
+    return juce::String::formatted("health %.1f ms, connect %.1f ms, send %.1f ms, wait %.1f ms, "
+                                   "read %.1f ms, parse %.1f ms, total %.1f ms (%d attempt%s, %s connection)",
+                                   healthCheckMs, connectMs, sendMs, waitMs, readMs, parseMs, totalMs,
+                                   attempts, attempts == 1 ? "" : "s",
+                                   reusedConnection ? "reused" : "new");
+}
+
+juce::String BackendStatus::describe() const
+{
+    if (!reachable)
+        return "AI backend not reachable";
+
+    if (ready)
+        return "AI backend ready";
+
+    if (state == "error")
+        return "Model failed to load: " + error;
+
+    return "Loading model: " + stage + " (" + juce::String(juce::roundToInt(progress * 100.0f)) + "%)";
+}
+
 AIGenerator::AIGenerator()
 {
+    setServerURL(serverURL);
+}
+
+AIGenerator::~AIGenerator()
+{
+    if (idleSocket != nullptr)
+        idleSocket->close();
 }
 
-GenerationResult AIGenerator::generate(const juce::String& prompt, float duration)
+void AIGenerator::setServerURL(const juce::String& url)
 {
-    return sendHTTPRequest(prompt, duration);
+    const juce::ScopedLock sl(connectionLock);
+
+    serverURL = url.trimCharactersAtEnd("/");
+
+    juce::URL parsed(serverURL);
+    host = parsed.getDomain();
+    port = parsed.getPort() > 0 ? parsed.getPort() : 80;
+
+    // A different server invalidates the kept-alive connection, including
+    // one a request has checked out
+    if (idleSocket != nullptr)
+    {
+        idleSocket->close();
+        idleSocket.reset();
+    }
+
+    ++serverGeneration;
+    lastHealthyTime = 0;
+}
+
+juce::String AIGenerator::getServerURL() const
+{
+    const juce::ScopedLock sl(connectionLock);
+    return serverURL;
+}
+
+RequestTimings AIGenerator::getLastTimings() const
+{
+    const juce::ScopedLock sl(connectionLock);
+    return lastTimings;
+}
+
+GenerationResult AIGenerator::generate(const juce::String& prompt, float duration, double sampleRate,
+                                       const GenerationOptions& options)
+{
+    return sendHTTPRequest(prompt, duration, sampleRate, options);
+}
+
+bool AIGenerator::checkHealth()
+{
+    return getBackendStatus().reachable;
+}
+
+BackendStatus AIGenerator::getBackendStatus()
+{
+    BackendStatus status;
+    RequestTimings timings;
+
+    auto connection = checkoutConnection();
+    auto response = performRequest(connection, "GET", "/health", {}, healthTimeoutMs, timings);
+    returnConnection(connection);
+
+    if (!response.received || response.statusCode != 200)
+    {
+        lastHealthyTime = 0;
+        return status;
+    }
+
+    status.reachable = true;
+
+    juce::var parsedJson;
+    if (juce::JSON::parse(response.body, parsedJson).wasOk())
+    {
+        // Servers that predate readiness reporting load lazily, so treat them as ready
+        status.ready = (bool)parsedJson.getProperty("ready", true);
+        status.progress = (float)(double)parsedJson.getProperty("progress", status.ready ? 1.0 : 0.0);
+        status.state = parsedJson.getProperty("state", status.ready ? "ready" : "loading").toString();
+        status.stage = parsedJson.getProperty("stage", {}).toString();
+        status.error = parsedJson.getProperty("error", {}).toString();
+    }
+
+    lastHealthyTime = status.ready ? juce::Time::getMillisecondCounter() : 0;
+
+    return status;
 }
 
-GenerationResult AIGenerator::sendHTTPRequest(const juce::String& prompt, float duration)
+GenerationResult AIGenerator::sendHTTPRequest(const juce::String& prompt, float duration, double sampleRate,
+                                              const GenerationOptions& options)
 {
     GenerationResult result;
-    
+    result.errorMessage = validateRequest(prompt, duration, sampleRate);
+
+    if (result.errorMessage.isNotEmpty())
+        return result;
+
+    juce::var body(new juce::DynamicObject());
+    auto* request = body.getDynamicObject();
+    request->setProperty("prompt", prompt);
+    request->setProperty("duration", duration);
+    request->setProperty("sample_rate", juce::roundToInt(sampleRate));
+
+    if (options.seed >= 0)
+        request->setProperty("seed", options.seed);
+
+    if (options.lowPriority)
+        request->setProperty("priority", "low");
+
+    juce::var parsedJson;
+
+    if (postJSON("/generate", body, timeoutSeconds * 1000,
+                 parsedJson, result.errorMessage, result.timings))
+    {
+        // Extract WAV file path
+        result.wavFilePath = parsedJson["wav_path"].toString();
+        result.analysis = SampleAnalysis::fromJSON(parsedJson["analysis"]);
+        result.success = result.wavFilePath.isNotEmpty();
+
+        if (!result.success)
+            result.errorMessage = "Invalid response format from server";
+    }
+    else
+    {
+        result.preempted = (bool)parsedJson.getProperty("preempted", false);
+    }
+
+    return result;
+}
+
+BatchGenerationResult AIGenerator::generateBatch(const juce::String& prompt,
+                                                 const juce::Array<int>& midiNotes,
+                                                 float duration,
+                                                 double sampleRate)
+{
+    BatchGenerationResult result;
+    result.errorMessage = validateRequest(prompt, duration, sampleRate);
+
+    if (result.errorMessage.isEmpty() && midiNotes.isEmpty())
+        result.errorMessage = "No notes requested";
+
+    juce::Array<juce::var> notes;
+
+    for (auto note : midiNotes)
+    {
+        if (result.errorMessage.isEmpty() && !juce::isPositiveAndBelow(note, 128))
+            result.errorMessage = "Invalid MIDI note: " + juce::String(note);
+
+        notes.add(note);
+    }
+
+    if (result.errorMessage.isNotEmpty())
+        return result;
+
+    juce::var body(new juce::DynamicObject());
+    auto* request = body.getDynamicObject();
+    request->setProperty("prompt", prompt);
+    request->setProperty("duration", duration);
+    request->setProperty("notes", notes);
+    request->setProperty("sample_rate", juce::roundToInt(sampleRate));
+
+    // A batch never takes longer than the same clips generated one by one
+    const int readTimeoutMs = timeoutSeconds * 1000 * juce::jmax(1, midiNotes.size());
+    juce::var parsedJson;
+
+    if (postJSON("/generate_batch", body, readTimeoutMs,
+                 parsedJson, result.errorMessage, result.timings))
+    {
+        if (auto* paths = parsedJson["wav_paths"].getArray())
+            for (auto& path : *paths)
+                result.wavFilePaths.add(path.toString());
+
+        // Older backends send no analysis; the engine then analyses itself
+        if (auto* analyses = parsedJson["analysis"].getArray())
+            for (auto& analysis : *analyses)
+                result.analyses.push_back(SampleAnalysis::fromJSON(analysis));
+
+        result.midiNotes = midiNotes;
+        result.success = result.wavFilePaths.size() == midiNotes.size();
+
+        if (!result.success)
+            result.errorMessage = "Server returned " + juce::String(result.wavFilePaths.size())
+                                + " samples for " + juce::String(midiNotes.size()) + " notes";
+    }
+
+    return result;
+}
+
+bool AIGenerator::postJSON(const juce::String& path, const juce::var& body, int readTimeoutMs,
+                           juce::var& parsedJson, juce::String& errorMessage, RequestTimings& timings)
+{
+    const double requestStart = nowMs();
+    bool ok = false;
+
     try
     {
-        // Build JSON request
-        juce::DynamicObject::Ptr jsonObject = new juce::DynamicObject();
-        jsonObject->setProperty("prompt", prompt);
-        jsonObject->setProperty("duration", duration);
-        
-        juce::var jsonVar(jsonObject.get());
-        juce::String jsonString = juce::JSON::toString(jsonVar);
-        
-        // Create URL
-        juce::URL url(serverURL + "/generate");
-        
-        // Set up HTTP request
-        juce::URL::InputStreamOptions options = juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
-            .withConnectionTimeoutMs(timeoutSeconds * 1000)
-            .withExtraHeaders("Content-Type: application/json");
-        
-        // Send POST request
-        std::unique_ptr<juce::InputStream> stream(url.createInputStream(
-            options.withHttpRequestCmd("POST").withPostData(jsonString)
-        ));
-        
-        if (stream == nullptr)
+        // Preflight against /health so a dead backend fails in milliseconds
+        // instead of stalling for the full read timeout
+        bool ready = true;
+
+        const juce::uint32 healthyTime = lastHealthyTime.load();
+
+        if (healthyTime == 0 || juce::Time::getMillisecondCounter() - healthyTime > healthValidityMs)
         {
-            result.errorMessage = "Failed to connect to server at " + serverURL;
-            return result;
+            const double healthStart = nowMs();
+            const auto status = getBackendStatus();
+            timings.healthCheckMs = nowMs() - healthStart;
+
+            if (!status.ready)
+            {
+                errorMessage = status.reachable ? status.describe()
+                                                : "Backend not reachable at " + getServerURL();
+                ready = false;
+            }
         }
-        
-        // Read response
-        juce::String response = stream->readEntireStreamAsString();
-        
-        // Parse JSON response
-        juce::var parsedJson;
-        juce::Result parseResult = juce::JSON::parse(response, parsedJson);
-        
-        if (!parseResult.wasOk())
+
+        if (ready)
         {
-            result.errorMessage = "Failed to parse server response: " + parseResult.getErrorMessage();
-            return result;
+            auto connection = checkoutConnection();
+            auto response = performRequest(connection, "POST", path, juce::JSON::toString(body, true),
+                                           readTimeoutMs, timings);
+            returnConnection(connection);
+
+            if (!response.received)
+            {
+                errorMessage = response.error;
+            }
+            else
+            {
+                lastHealthyTime = juce::Time::getMillisecondCounter();
+
+                // Parse JSON response
+                const double parseStart = nowMs();
+                juce::Result parseResult = juce::JSON::parse(response.body, parsedJson);
+                timings.parseMs = nowMs() - parseStart;
+
+                if (!parseResult.wasOk())
+                    errorMessage = "Failed to parse server response: " + parseResult.getErrorMessage();
+                else if (parsedJson.hasProperty("error"))
+                    errorMessage = parsedJson["error"].toString();
+                else if (response.statusCode != 200)
+                    errorMessage = "Server returned HTTP " + juce::String(response.statusCode);
+                else
+                    ok = true;
+            }
         }
-        
-        // Extract WAV file path
-        if (parsedJson.hasProperty("wav_path"))
+    }
+    catch (const std::exception& e)
+    {
+        errorMessage = "Exception: " + juce::String(e.what());
+    }
+
+    timings.totalMs = nowMs() - requestStart;
+
+    {
+        const juce::ScopedLock sl(connectionLock);
+        lastTimings = timings;
+    }
+
+    return ok;
+}
+
+//==============================================================================
+AIGenerator::Connection AIGenerator::checkoutConnection()
+{
+    const juce::ScopedLock sl(connectionLock);
+
+    Connection connection;
+    connection.socket = std::move(idleSocket);
+    connection.serverURL = serverURL;
+    connection.host = host;
+    connection.port = port;
+    connection.serverGeneration = serverGeneration;
+    return connection;
+}
+
+void AIGenerator::returnConnection(Connection& connection)
+{
+    if (connection.socket == nullptr)
+        return;
+
+    {
+        const juce::ScopedLock sl(connectionLock);
+
+        if (connection.socket->isConnected() && idleSocket == nullptr
+            && connection.serverGeneration == serverGeneration)
         {
-            result.wavFilePath = parsedJson["wav_path"].toString();
-            result.success = true;
+            idleSocket = std::move(connection.socket);
+            return;
         }
-        else if (parsedJson.hasProperty("error"))
+    }
+
+    closeConnection(connection);
+}
+
+AIGenerator::HTTPResponse AIGenerator::performRequest(Connection& connection,
+                                                      const juce::String& method,
+                                                      const juce::String& path,
+                                                      const juce::String& body,
+                                                      int readTimeoutMs,
+                                                      RequestTimings& timings)
+{
+    for (int attempt = 0;; ++attempt)
+    {
+        timings.attempts = attempt + 1;
+
+        const bool wasConnected = connection.socket != nullptr && connection.socket->isConnected();
+        auto response = performRequestOnce(connection, method, path, body, readTimeoutMs, timings);
+
+        if (!response.received || !response.keepAlive)
+            closeConnection(connection);
+
+        if (response.received || !response.retryable || attempt >= maxRetries)
+            return response;
+
+        // A stopping thread gives up between attempts, so a backend that
+        // cannot be reached never holds up stopThread for every retry
+        if (juce::Thread::currentThreadShouldExit())
+            return response;
+
+        // The server may have dropped an idle kept-alive connection; that is
+        // retried straight away, anything else backs off exponentially
+        if (!wasConnected)
         {
-            result.errorMessage = parsedJson["error"].toString();
+            juce::Thread::sleep(retryBaseDelayMs << attempt);
+
+            if (juce::Thread::currentThreadShouldExit())
+                return response;
         }
-        else
+    }
+}
+
+AIGenerator::HTTPResponse AIGenerator::performRequestOnce(Connection& connection,
+                                                          const juce::String& method,
+                                                          const juce::String& path,
+                                                          const juce::String& body,
+                                                          int readTimeoutMs,
+                                                          RequestTimings& timings)
+{
+    HTTPResponse response;
+    const auto& serverURL = connection.serverURL;
+
+    if (!ensureConnected(connection, timings))
+    {
+        response.retryable = true;
+        response.error = "Failed to connect to server at " + serverURL;
+        return response;
+    }
+
+    auto& socket = connection.socket;
+
+    // Send request
+    const double sendStart = nowMs();
+
+    juce::MemoryOutputStream request;
+    request << method << " " << path << " HTTP/1.1\r\n"
+            << "Host: " << connection.host << ":" << connection.port << "\r\n"
+            << "Connection: keep-alive\r\n";
+
+    if (body.isNotEmpty())
+        request << "Content-Type: application/json\r\n"
+                << "Content-Length: " << (int)body.getNumBytesAsUTF8() << "\r\n";
+
+    request << "\r\n";
+    request.write(body.toRawUTF8(), body.getNumBytesAsUTF8());
+
+    if (socket->write(request.getData(), (int)request.getDataSize()) != (int)request.getDataSize())
+    {
+        response.retryable = true;
+        response.error = "Failed to send request to " + serverURL;
+        return response;
+    }
+
+    const double sendEnd = nowMs();
+    timings.sendMs = sendEnd - sendStart;
+
+    // Read response, bounded by the read timeout
+    const double deadline = sendEnd + readTimeoutMs;
+    juce::MemoryBlock received;
+    size_t receivedSize = 0;
+    int headerEnd = -1;
+    int contentLength = -1;
+    double firstByteTime = 0.0;
+    char chunk[8192];
+
+    for (;;)
+    {
+        if (headerEnd >= 0 && contentLength >= 0
+            && (int)receivedSize >= headerEnd + 4 + contentLength)
+            break;
+
+        const int remainingMs = (int)(deadline - nowMs());
+
+        if (remainingMs <= 0)
         {
-            result.errorMessage = "Invalid response format from server";
+            response.error = "Timed out waiting for server response after "
+                           + juce::String(readTimeoutMs / 1000.0, 1) + "s";
+            return response;
+        }
+
+        // Wait in short slices so a stopping thread abandons the request
+        if (juce::Thread::currentThreadShouldExit())
+        {
+            response.error = "Request abandoned";
+            return response;
+        }
+
+        const int ready = socket->waitUntilReady(true, juce::jmin(remainingMs, abandonCheckIntervalMs));
+
+        if (ready == 0)
+            continue;
+
+        const int bytesRead = ready < 0 ? -1 : socket->read(chunk, (int)sizeof(chunk), false);
+
+        if (bytesRead <= 0)
+        {
+            // Without a Content-Length the body ends when the server closes
+            if (headerEnd >= 0 && contentLength < 0)
+            {
+                response.keepAlive = false;
+                break;
+            }
+
+            // Nothing came back. A reused keep-alive socket was most likely
+            // closed by the server while idle, before it read this request;
+            // on a fresh one the server may have read it and failed while
+            // handling it, so only a GET is safe to send again
+            response.retryable = receivedSize == 0 && (timings.reusedConnection || method == "GET");
+            response.error = "Connection closed by server at " + serverURL;
+            return response;
+        }
+
+        if (receivedSize == 0)
+            firstByteTime = nowMs();
+
+        received.append(chunk, (size_t)bytesRead);
+        receivedSize += (size_t)bytesRead;
+
+        if (headerEnd < 0)
+        {
+            const auto* data = static_cast<const char*>(received.getData());
+            headerEnd = findHeaderEnd(data, (int)receivedSize, (int)receivedSize - bytesRead - 3);
+
+            if (headerEnd >= 0)
+            {
+                auto headerLines = juce::StringArray::fromLines(juce::String::fromUTF8(data, headerEnd));
+                auto statusLine = headerLines[0];
+
+                response.statusCode = statusLine.fromFirstOccurrenceOf(" ", false, false).getIntValue();
+                response.keepAlive = statusLine.startsWith("HTTP/1.1");
+
+                for (int i = 1; i < headerLines.size(); ++i)
+                {
+                    auto name = headerLines[i].upToFirstOccurrenceOf(":", false, false).trim();
+                    auto value = headerLines[i].fromFirstOccurrenceOf(":", false, false).trim();
+
+                    if (name.equalsIgnoreCase("Content-Length"))
+                        contentLength = value.getIntValue();
+                    else if (name.equalsIgnoreCase("Connection"))
+                        response.keepAlive = value.equalsIgnoreCase("keep-alive");
+                }
+            }
         }
     }
-    catch (const std::exception& e)
+
+    const auto* data = static_cast<const char*>(received.getData());
+    const int bodyStart = headerEnd + 4;
+    const int bodyLength = contentLength >= 0 ? contentLength : (int)receivedSize - bodyStart;
+
+    response.body = juce::String::fromUTF8(data + bodyStart, bodyLength);
+    response.received = true;
+
+    const double readEnd = nowMs();
+    timings.waitMs = firstByteTime - sendEnd;
+    timings.readMs = readEnd - firstByteTime;
+
+    return response;
+}
+
+bool AIGenerator::ensureConnected(Connection& connection, RequestTimings& timings)
+{
+    auto& socket = connection.socket;
+
+    if (socket != nullptr && socket->isConnected())
     {
-        result.errorMessage = "Exception: " + juce::String(e.what());
+        timings.reusedConnection = true;
+        timings.connectMs = 0.0;
+        return true;
+    }
+
+    const double connectStart = nowMs();
+
+    socket = std::make_unique<juce::StreamingSocket>();
+    const bool connected = socket->connect(connection.host, connection.port, connectTimeoutMs);
+
+    timings.reusedConnection = false;
+    timings.connectMs = nowMs() - connectStart;
+
+    if (!connected)
+        socket.reset();
+
+    return connected;
+}
+
+void AIGenerator::closeConnection(Connection& connection)
+{
+    if (connection.socket != nullptr)
+    {
+        connection.socket->close();
+        connection.socket.reset();
     }
-    
-    return result;
 }
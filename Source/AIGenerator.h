@@ -1,32 +1,174 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SampleAnalysis.h"
+
+//==============================================================================
+// Per-phase latency of one backend call, in milliseconds
+struct RequestTimings
+{
+    double healthCheckMs = 0.0;
+    double connectMs = 0.0;
+    double sendMs = 0.0;
+    double waitMs = 0.0;    // time to first response byte (server-side work)
+    double readMs = 0.0;
+    double parseMs = 0.0;
+    double totalMs = 0.0;
+    int attempts = 0;
+    bool reusedConnection = false;
+
+    juce::String toString() const;
+};
 
 //==============================================================================
 struct GenerationResult
 {
     bool success = false;
     juce::String wavFilePath;
+    SampleAnalysis analysis;            // not present with older backends
+    juce::String errorMessage;
+    bool preempted = false;             // low-priority request refused or cancelled
+    RequestTimings timings;
+};
+
+//==============================================================================
+struct GenerationOptions
+{
+    int seed = -1;                      // -1 lets the backend pick
+    
+    // Speculative work: the backend refuses or cancels it as soon as a
+    // normal request needs the model
+    bool lowPriority = false;
+};
+
+//==============================================================================
+struct BatchGenerationResult
+{
+    bool success = false;
+    juce::StringArray wavFilePaths;     // one per requested note, same order
+    juce::Array<int> midiNotes;
+    std::vector<SampleAnalysis> analyses;
     juce::String errorMessage;
+    RequestTimings timings;
+};
+
+//==============================================================================
+// Backend readiness as reported by GET /health
+struct BackendStatus
+{
+    bool reachable = false;
+    bool ready = false;         // model loaded and warmed up
+    float progress = 0.0f;      // 0..1 while the model is loading
+    juce::String state;         // "loading", "warming_up", "ready", "error", ...
+    juce::String stage;         // human readable loading step
+    juce::String error;
+
+    juce::String describe() const;
 };
 
 //==============================================================================
 // AI Generator client - communicates with Python backend
+//
+// Requests go over a keep-alive HTTP/1.1 connection that is reused between
+// calls, so repeated generations skip TCP setup. Every read is bounded by a
+// timeout and transport failures are retried with backoff. A request checks
+// the connection out for its duration; one made meanwhile, such as a
+// health poll during a generation, opens its own.
 class AIGenerator
 {
 public:
     AIGenerator();
+    ~AIGenerator();
+
+    // Synchronous generation (blocks until complete). The backend writes
+    // the clip at sampleRate and analyses it there.
+    GenerationResult generate(const juce::String& prompt, float duration = 3.0f,
+                              double sampleRate = 44100.0,
+                              const GenerationOptions& options = {});
     
-    // Synchronous generation (blocks until complete)
-    GenerationResult generate(const juce::String& prompt, float duration = 3.0f);
+    // Generates one pitched sample per MIDI note in a single batched call
+    BatchGenerationResult generateBatch(const juce::String& prompt,
+                                        const juce::Array<int>& midiNotes,
+                                        float duration = 3.0f,
+                                        double sampleRate = 44100.0);
+
+    // Quick GET /health round-trip; false if the backend is unreachable
+    bool checkHealth();
     
+    // GET /health including model loading progress
+    BackendStatus getBackendStatus();
+
     // Configuration
-    void setServerURL(const juce::String& url) { serverURL = url; }
+    void setServerURL(const juce::String& url);
+    juce::String getServerURL() const;
     void setTimeout(int seconds) { timeoutSeconds = seconds; }
+    void setConnectTimeout(int milliseconds) { connectTimeoutMs = milliseconds; }
+    void setMaxRetries(int retries) { maxRetries = juce::jmax(0, retries); }
+
+    RequestTimings getLastTimings() const;
 
 private:
+    // A socket checked out for one request, with the server it talks to
+    struct Connection
+    {
+        std::unique_ptr<juce::StreamingSocket> socket;
+        juce::String serverURL;
+        juce::String host;
+        int port = 0;
+        int serverGeneration = 0;
+    };
+
+    struct HTTPResponse
+    {
+        bool received = false;      // false on any transport failure
+        bool retryable = false;     // sending again cannot repeat work the server did
+        int statusCode = 0;
+        bool keepAlive = true;
+        juce::String body;
+        juce::String error;
+    };
+
     juce::String serverURL = "http://localhost:5000";
-    int timeoutSeconds = 60;
+    juce::String host = "localhost";
+    int port = 5000;
+
+    int timeoutSeconds = 60;        // read timeout for /generate
+    int connectTimeoutMs = 2000;
+    int healthTimeoutMs = 2000;
+    int maxRetries = 2;
+    int retryBaseDelayMs = 250;
+
+    static constexpr juce::uint32 healthValidityMs = 5000;
+    static constexpr int abandonCheckIntervalMs = 100;
+
+    // Guards the server address, idleSocket and lastTimings; never held
+    // while a request is in flight
+    mutable juce::CriticalSection connectionLock;
+    std::unique_ptr<juce::StreamingSocket> idleSocket;
+    int serverGeneration = 0;           // bumped by setServerURL
+    RequestTimings lastTimings;
+
+    std::atomic<juce::uint32> lastHealthyTime { 0 };
+
+    GenerationResult sendHTTPRequest(const juce::String& prompt, float duration, double sampleRate,
+                                     const GenerationOptions& options);
     
-    GenerationResult sendHTTPRequest(const juce::String& prompt, float duration);
+    // Health preflight + POST; parsedJson holds the response body whenever
+    // one was received, including error responses
+    bool postJSON(const juce::String& path, const juce::var& body, int readTimeoutMs,
+                  juce::var& parsedJson, juce::String& errorMessage, RequestTimings& timings);
+
+    // Checkout hands over the idle socket, if any; return keeps a still
+    // open one for the next request unless the server changed meanwhile
+    Connection checkoutConnection();
+    void returnConnection(Connection& connection);
+
+    HTTPResponse performRequest(Connection& connection, const juce::String& method, const juce::String& path,
+                                const juce::String& body, int readTimeoutMs, RequestTimings& timings);
+    HTTPResponse performRequestOnce(Connection& connection, const juce::String& method, const juce::String& path,
+                                    const juce::String& body, int readTimeoutMs, RequestTimings& timings);
+    bool ensureConnected(Connection& connection, RequestTimings& timings);
+    static void closeConnection(Connection& connection);
+
+    JUCE_DECLARE_NON_COPYABLE (AIGenerator)
 };
@@ -0,0 +1,564 @@
+#include "Benchmarks.h"
+#include "SamplerEngine.h"
+#include "OfflineRenderer.h"
+#include "VoiceRenderer.h"
+#include "PromptIndex.h"
+#include "FastMath.h"
+#include "VoiceFilterBank.h"
+#include "SyntheticSignals.h"
+
+namespace
+{
+    constexpr double benchSampleRate = 44100.0;
+
+    void print(const juce::String& line)
+    {
+        std::cout << line << std::endl;
+    }
+
+    using SyntheticSignals::makeTone;
+
+    AISamplerSound::Ptr makeToneSound(float frequency, double seconds)
+    {
+        auto buffer = makeTone(frequency, seconds, benchSampleRate);
+        return AISamplerEngine::createAnalysedSound(buffer, benchSampleRate);
+    }
+
+    // Repeating chords of notesPerChord notes, one chord per second
+    juce::MidiMessageSequence makeChordSequence(double seconds, int notesPerChord)
+    {
+        juce::MidiMessageSequence sequence;
+
+        for (double t = 0.0; t < seconds; t += 1.0)
+        {
+            for (int n = 0; n < notesPerChord; ++n)
+            {
+                const int note = 36 + (n * 7 + (int)t) % 60;
+                sequence.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f), t);
+                sequence.addEvent(juce::MidiMessage::noteOff(1, note), t + 0.9);
+            }
+        }
+
+        sequence.updateMatchedPairs();
+        return sequence;
+    }
+}
+
+//==============================================================================
+BenchmarkRunner::BenchmarkRunner()
+    : workDirectory(juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("AIGenVSTBenchmarks"))
+{
+}
+
+juce::StringArray BenchmarkRunner::getSuiteNames()
+{
+    return { "analysis", "render", "voice", "compact", "index", "stretch", "mpe", "filter" };
+}
+
+int BenchmarkRunner::run(const juce::StringArray& suites)
+{
+    const auto selected = suites.isEmpty() ? getSuiteNames() : suites;
+
+    // Held for the whole run, so analysis timings leave out thread startup
+    juce::SharedResourcePointer<AnalysisThreadPool> analysisPool;
+
+    for (auto& suite : selected)
+    {
+        if (!getSuiteNames().contains(suite))
+        {
+            print("Unknown benchmark suite: " + suite + " (available: "
+                  + getSuiteNames().joinIntoString(", ") + ")");
+            return 1;
+        }
+    }
+
+    workDirectory.createDirectory();
+
+    print("Cores: " + juce::String(juce::SystemStats::getNumCpus()));
+
+    if (selected.contains("analysis"))
+        benchmarkAnalysis();
+
+    if (selected.contains("render"))
+        benchmarkRender();
+
+    if (selected.contains("voice"))
+        benchmarkVoice();
+
+    if (selected.contains("compact"))
+        benchmarkCompact();
+
+    if (selected.contains("index"))
+        benchmarkIndex();
+
+    if (selected.contains("stretch"))
+        benchmarkStretch();
+
+    if (selected.contains("mpe"))
+        benchmarkMPE();
+
+    if (selected.contains("filter"))
+        benchmarkFilter();
+
+    workDirectory.deleteRecursively();
+    return 0;
+}
+
+double BenchmarkRunner::timeBestOf(int runs, const std::function<void()>& work)
+{
+    double best = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < runs; ++i)
+    {
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        work();
+        best = juce::jmin(best, juce::Time::getMillisecondCounterHiRes() - start);
+    }
+
+    return best;
+}
+
+//==============================================================================
+void BenchmarkRunner::benchmarkAnalysis()
+{
+    constexpr int maxFiles = 64;
+
+    print("");
+    print("== analysis: decode + trim + normalize + pitch + loop, 2 s mono files ==");
+
+    // Write the input set once, every run reads the same files
+    juce::StringArray paths;
+
+    for (int i = 0; i < maxFiles; ++i)
+    {
+        auto file = workDirectory.getChildFile("tone" + juce::String(i) + ".wav");
+        auto tone = makeTone(55.0f * std::pow(2.0f, (float)(i % 48) / 12.0f), 2.0, benchSampleRate);
+
+        if (auto writer = OfflineRenderer::createWavWriter(file, benchSampleRate, 1))
+            writer->writeFromAudioSampleBuffer(tone, 0, tone.getNumSamples());
+
+        paths.add(file.getFullPathName());
+    }
+
+    print(juce::String::formatted("%8s %14s %14s %10s", "files", "serial ms", "parallel ms", "speedup"));
+
+    for (int numFiles = 1; numFiles <= maxFiles; numFiles *= 2)
+    {
+        juce::StringArray subset;
+        for (int i = 0; i < numFiles; ++i)
+            subset.add(paths[i]);
+
+        const double serialMs = timeBestOf(3, [&subset]
+        {
+            for (auto& path : subset)
+                AISamplerEngine::analyseFiles(juce::StringArray(path));
+        });
+
+        const double parallelMs = timeBestOf(3, [&subset]
+        {
+            AISamplerEngine::analyseFiles(subset);
+        });
+
+        print(juce::String::formatted("%8d %14.1f %14.1f %9.2fx",
+                                      numFiles, serialMs, parallelMs, serialMs / parallelMs));
+    }
+}
+
+void BenchmarkRunner::benchmarkRender()
+{
+    print("");
+    print("== render: 60 s of 8-note chords through AISamplerEngine ==");
+    print(juce::String::formatted("%8s %14s %14s", "block", "render ms", "x realtime"));
+
+    std::vector<AISamplerSound::Ptr> sounds { makeToneSound(110.0f, 4.0) };
+    const auto sequence = makeChordSequence(60.0, 8);
+
+    for (int blockSize : { 64, 256, 1024 })
+    {
+        OfflineRenderer renderer(sounds, 48000.0, blockSize);
+        RenderStats stats;
+
+        timeBestOf(3, [&] { stats = renderer.render(sequence, nullptr); });
+
+        print(juce::String::formatted("%8d %14.1f %13.1fx",
+                                      blockSize, stats.renderSeconds * 1000.0, stats.getRealtimeFactor()));
+    }
+}
+
+void BenchmarkRunner::benchmarkVoice()
+{
+    constexpr int numSamples = 1 << 20;
+    const char* modeNames[] = { "drop", "linear", "hermite" };
+
+    print("");
+    print("== voice: one kernel specialisation over 2^20 output samples, ratio 1.26 ==");
+    print(juce::String::formatted("%10s %10s %10s %14s", "mode", "channels", "gain", "ns/sample"));
+
+    // Long enough that a single span never reaches the end of the source
+    const auto source = makeTone(220.0f, 30.0, benchSampleRate);
+    juce::AudioBuffer<float> output(2, numSamples);
+
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        for (int channels : { 1, 2 })
+        {
+            for (bool ramping : { false, true })
+            {
+                const auto kernel = VoiceRenderer::getKernel((InterpolationMode)mode, channels, ramping);
+
+                const double ms = timeBestOf(5, [&]
+                {
+                    output.clear();
+
+                    VoiceRenderer::Span span;
+                    span.source = source.getReadPointer(0);
+                    span.outputs = output.getArrayOfWritePointers();
+                    span.numOutputChannels = channels;
+                    span.phase = VoiceRenderer::phaseOne;
+                    span.increment = VoiceRenderer::toPhaseIncrement(1.26);
+                    span.gain = ramping ? 0.0f : 0.8f;
+                    span.gainIncrement = ramping ? 0.8f / (float)numSamples : 0.0f;
+
+                    kernel(span, numSamples);
+                });
+
+                print(juce::String::formatted("%10s %10d %10s %14.2f",
+                                              modeNames[mode], channels, ramping ? "ramp" : "flat",
+                                              ms * 1.0e6 / numSamples));
+            }
+        }
+    }
+}
+
+void BenchmarkRunner::benchmarkCompact()
+{
+    constexpr double seconds = 10.0;
+    constexpr int blockSize = 256;
+
+    print("");
+    print("== compact: one distinct 4 s zone per voice, float vs 16-bit block-scaled ==");
+    print(juce::String::formatted("%8s %10s %12s %12s %12s %10s",
+                                  "voices", "storage", "resident MB", "render ms", "x realtime", "speedup"));
+
+    for (int numVoices : { 16, 64, 128 })
+    {
+        double floatMs = 0.0;
+
+        for (bool compact : { false, true })
+        {
+            // Every voice reads its own sound, so the working set grows with
+            // the voice count instead of staying in cache
+            std::vector<AISamplerSound::Ptr> sounds;
+            juce::Array<int> zoneNotes;
+            size_t residentBytes = 0;
+
+            for (int v = 0; v < numVoices; ++v)
+            {
+                const int note = 64 - numVoices / 2 + v;
+                auto tone = makeTone(110.0f * std::pow(2.0f, (float)(v % 24) / 12.0f), 4.0, benchSampleRate);
+
+                AISamplerSound::Ptr sound = new AISamplerSound("Bench", tone, note, benchSampleRate);
+
+                if (compact)
+                    sound->makeCompact();
+
+                residentBytes += sound->getSizeInBytes();
+                sounds.push_back(sound);
+                zoneNotes.add(note);
+            }
+
+            AISamplerEngine::mapKeyZones(sounds, zoneNotes);
+
+            const double ms = timeBestOf(3, [&]
+            {
+                AISamplerEngine engine(numVoices);
+                engine.setCurrentPlaybackSampleRate(48000.0);
+                engine.loadPreparedSounds(sounds, "Bench");
+
+                juce::AudioBuffer<float> block(2, blockSize);
+                juce::MidiBuffer midi;
+
+                for (int note : zoneNotes)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f), 0);
+
+                for (int position = 0; position < (int)(seconds * 48000.0); position += blockSize)
+                {
+                    block.clear();
+                    engine.renderNextBlock(block, midi, 0, blockSize);
+                    midi.clear();
+                }
+            });
+
+            if (!compact)
+                floatMs = ms;
+
+            print(juce::String::formatted("%8d %10s %12.1f %12.1f %11.1fx %9.2fx",
+                                          numVoices, compact ? "compact" : "float",
+                                          (double)residentBytes / (1024.0 * 1024.0), ms,
+                                          seconds * 1000.0 / ms, floatMs / ms));
+        }
+    }
+}
+
+void BenchmarkRunner::benchmarkIndex()
+{
+    constexpr int numLookups = 200;
+    const char* adjectives[] = { "deep", "bright", "warm", "dark", "soft", "harsh", "airy", "gritty", "lush", "thin" };
+    const char* sources[] = { "bass", "pad", "lead", "bell", "pluck", "piano", "string", "choir", "brass", "organ" };
+    const char* extras[] = { "synth", "analog", "vintage", "fm", "detuned", "reverb", "staccato", "glassy", "tape", "sub" };
+
+    print("");
+    print("== index: nearest prompt among N stored prompts, reopened from disk ==");
+    print(juce::String::formatted("%10s %12s %14s %14s", "entries", "build s", "lookup us", "max us"));
+
+    juce::Random random(42);
+
+    auto makePrompt = [&]
+    {
+        return juce::String(adjectives[random.nextInt(10)]) + " " + sources[random.nextInt(10)] + " "
+             + extras[random.nextInt(10)] + " " + extras[random.nextInt(10)] + " "
+             + juce::String(random.nextInt(100000));
+    };
+
+    for (int numEntries : { 1000, 10000, 100000 })
+    {
+        const auto directory = workDirectory.getChildFile("index" + juce::String(numEntries));
+        const double buildStart = juce::Time::getMillisecondCounterHiRes();
+
+        {
+            PromptIndex index(directory);
+
+            for (int i = 0; i < numEntries; ++i)
+                index.add(makePrompt(), directory.getChildFile(juce::String(i) + ".wav"));
+        }
+
+        const double buildSeconds = (juce::Time::getMillisecondCounterHiRes() - buildStart) / 1000.0;
+
+        // Reopening maps the vectors instead of reading them
+        PromptIndex index(directory);
+        double totalMs = 0.0;
+        double worstMs = 0.0;
+
+        for (int i = 0; i < numLookups; ++i)
+        {
+            const auto query = makePrompt();
+            const double start = juce::Time::getMillisecondCounterHiRes();
+            const auto match = index.findNearest(query);
+            const double ms = juce::Time::getMillisecondCounterHiRes() - start;
+
+            juce::ignoreUnused(match);
+            totalMs += ms;
+            worstMs = juce::jmax(worstMs, ms);
+        }
+
+        print(juce::String::formatted("%10d %12.2f %14.1f %14.1f",
+                                      index.size(), buildSeconds,
+                                      totalMs * 1000.0 / numLookups, worstMs * 1000.0));
+    }
+}
+
+void BenchmarkRunner::benchmarkStretch()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double seconds = 10.0;
+    constexpr int blockSize = 256;
+
+    print("");
+    print("== stretch: held notes on a looping 4 s zone, resampling vs time-stretched ==");
+    print(juce::String::formatted("%8s %12s %12s %16s %10s",
+                                  "voices", "mode", "render ms", "ns/voice-sample", "cost"));
+
+    auto sound = makeToneSound(110.0f, 4.0);
+    const auto& analysis = sound->getTimeStretchAnalysis();
+
+    print(juce::String::formatted("Grain %d samples, hop %d, %d pitch marks",
+                                  analysis.grainLength, analysis.hop, (int)analysis.pitchMarks.size()));
+
+    const std::vector<AISamplerSound::Ptr> sounds { sound };
+
+    for (int numVoices : { 1, 16 })
+    {
+        double resampleMs = 0.0;
+
+        for (auto mode : { PlaybackMode::resample, PlaybackMode::timeStretch })
+        {
+            const double ms = timeBestOf(3, [&]
+            {
+                AISamplerEngine engine(numVoices);
+                engine.setCurrentPlaybackSampleRate(sampleRate);
+                engine.setPlaybackMode(mode);
+                engine.loadPreparedSounds(sounds, "Bench");
+
+                juce::AudioBuffer<float> block(2, blockSize);
+                juce::MidiBuffer midi;
+
+                // Spread over three octaves, so the resampler reads at many ratios
+                for (int v = 0; v < numVoices; ++v)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, 33 + (v * 5) % 36, 0.8f), 0);
+
+                for (int position = 0; position < (int)(seconds * sampleRate); position += blockSize)
+                {
+                    block.clear();
+                    engine.renderNextBlock(block, midi, 0, blockSize);
+                    midi.clear();
+                }
+            });
+
+            if (mode == PlaybackMode::resample)
+                resampleMs = ms;
+
+            print(juce::String::formatted("%8d %12s %12.1f %16.2f %9.2fx",
+                                          numVoices, mode == PlaybackMode::resample ? "resample" : "stretch", ms,
+                                          ms * 1.0e6 / (seconds * sampleRate * numVoices), ms / resampleMs));
+        }
+    }
+}
+
+void BenchmarkRunner::benchmarkMPE()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double seconds = 10.0;
+    constexpr int blockSize = 256;
+    constexpr int numVoices = 16;
+
+    print("");
+    print("== mpe: 16 held notes on channels 2-16, static vs per-block bend, pressure and CC74 ==");
+
+    // Accuracy of the span-end exponential over the full 48 semitone range
+    float worstError = 0.0f;
+
+    for (float semitones = -48.0f; semitones <= 48.0f; semitones += 0.01f)
+    {
+        const float exact = std::exp2(semitones / 12.0f);
+        worstError = juce::jmax(worstError, std::abs(FastMath::semitonesToRatio(semitones) - exact) / exact);
+    }
+
+    print(juce::String::formatted("FastMath::exp2 worst relative error %.2e (%.5f cents)",
+                                  worstError, 1200.0 * std::log2(1.0 + worstError)));
+
+    print(juce::String::formatted("%12s %12s %16s %10s", "expression", "render ms", "ns/voice-sample", "cost"));
+
+    const std::vector<AISamplerSound::Ptr> sounds { makeToneSound(220.0f, 4.0) };
+    double staticMs = 0.0;
+
+    for (bool modulated : { false, true })
+    {
+        const double ms = timeBestOf(3, [&]
+        {
+            AISamplerEngine engine(numVoices);
+            engine.setCurrentPlaybackSampleRate(sampleRate);
+            engine.setMPEEnabled(true);
+            engine.loadPreparedSounds(sounds, "Bench");
+
+            juce::AudioBuffer<float> block(2, blockSize);
+            juce::MidiBuffer midi;
+
+            for (int v = 0; v < numVoices; ++v)
+                midi.addEvent(juce::MidiMessage::noteOn(2 + v % 15, 48 + v * 2, 0.8f), 0);
+
+            int blockIndex = 0;
+
+            for (int position = 0; position < (int)(seconds * sampleRate); position += blockSize, ++blockIndex)
+            {
+                // Every channel moves every block, each at its own phase, so
+                // every voice is always gliding
+                if (modulated)
+                {
+                    for (int channel = 2; channel <= 16; ++channel)
+                    {
+                        const double lfo = std::sin(0.05 * blockIndex + channel);
+                        midi.addEvent(juce::MidiMessage::pitchWheel(channel, 8192 + (int)(1000.0 * lfo)), 0);
+                        midi.addEvent(juce::MidiMessage::channelPressureChange(channel, 64 + (int)(60.0 * lfo)), 0);
+                        midi.addEvent(juce::MidiMessage::controllerEvent(channel, 74, 64 - (int)(60.0 * lfo)), 0);
+                    }
+                }
+
+                block.clear();
+                engine.renderNextBlock(block, midi, 0, blockSize);
+                midi.clear();
+            }
+        });
+
+        if (!modulated)
+            staticMs = ms;
+
+        print(juce::String::formatted("%12s %12.1f %16.2f %9.2fx",
+                                      modulated ? "modulated" : "static", ms,
+                                      ms * 1.0e6 / (seconds * sampleRate * numVoices), ms / staticMs));
+    }
+}
+
+void BenchmarkRunner::benchmarkFilter()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double seconds = 2.0;
+    constexpr int blockSize = VoiceFilterBank::controlInterval;
+    constexpr int numBlocks = (int)(seconds * sampleRate) / blockSize;
+
+    print("");
+    print("== filter: per-voice SVF, one voice at a time vs four lanes at a time, cutoffs moving every block ==");
+    print(juce::String::formatted("%8s %12s %12s %16s %10s %12s",
+                                  "voices", "mode", "filter ms", "ns/voice-sample", "speedup", "max diff"));
+
+    for (int numVoices : { 16, 64, 128 })
+    {
+        // Noise in every row, one voice in eight silent, types mixed
+        juce::Random random(numVoices);
+        juce::AudioBuffer<float> rows(numVoices, blockSize);
+
+        for (int v = 0; v < numVoices; ++v)
+            for (int i = 0; i < blockSize; ++i)
+                rows.setSample(v, i, random.nextFloat() * 2.0f - 1.0f);
+
+        std::vector<float> naiveMix((size_t)(numBlocks * blockSize));
+        std::vector<float> lanesMix(naiveMix.size());
+
+        auto run = [&](bool lanes)
+        {
+            VoiceFilterBank bank;
+            bank.prepare(numVoices);
+
+            std::vector<const float*> inputs((size_t)bank.getNumLanes(), nullptr);
+
+            for (int v = 0; v < numVoices; ++v)
+                inputs[(size_t)v] = v % 8 == 7 ? nullptr : rows.getReadPointer(v);
+
+            auto& mix = lanes ? lanesMix : naiveMix;
+            std::fill(mix.begin(), mix.end(), 0.0f);
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                // What the engine does per block: a cutoff per voice
+                for (int v = 0; v < numVoices; ++v)
+                {
+                    const float semitones = (float)((v * 7 + block) % 96);
+                    bank.setCoefficients(v, (VoiceFilterSettings::Type)(v % 3), 40.0f * FastMath::semitonesToRatio(semitones),
+                                         0.5f, sampleRate);
+                }
+
+                float* out = mix.data() + block * blockSize;
+
+                if (lanes)
+                    bank.process(inputs.data(), out, blockSize);
+                else
+                    bank.processScalar(inputs.data(), out, blockSize);
+            }
+        };
+
+        const double naiveMs = timeBestOf(5, [&] { run(false); });
+        const double lanesMs = timeBestOf(5, [&] { run(true); });
+
+        float maxDiff = 0.0f;
+
+        for (size_t i = 0; i < naiveMix.size(); ++i)
+            maxDiff = juce::jmax(maxDiff, std::abs(naiveMix[i] - lanesMix[i]));
+
+        const double voiceSamples = (double)numBlocks * blockSize * numVoices;
+
+        print(juce::String::formatted("%8d %12s %12.2f %16.2f %10s %12s",
+                                      numVoices, "per-voice", naiveMs, naiveMs * 1.0e6 / voiceSamples, "", ""));
+        print(juce::String::formatted("%8d %12s %12.2f %16.2f %9.2fx %12.2e",
+                                      numVoices, "lanes", lanesMs, lanesMs * 1.0e6 / voiceSamples,
+                                      naiveMs / lanesMs, maxDiff));
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Developer benchmarks, run with `AIGenRender --benchmark [suite ...]`.
+// Results are printed as plain text, one line per measurement.
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner();
+
+    // Runs the named suites, or all of them when suites is empty.
+    // Returns a process exit code.
+    int run(const juce::StringArray& suites);
+
+    static juce::StringArray getSuiteNames();
+
+private:
+    juce::File workDirectory;
+
+    void benchmarkAnalysis();
+    void benchmarkRender();
+    void benchmarkVoice();
+    void benchmarkCompact();
+    void benchmarkIndex();
+    void benchmarkStretch();
+    void benchmarkMPE();
+    void benchmarkFilter();
+
+    // Best wall-clock time of several runs, in milliseconds
+    static double timeBestOf(int runs, const std::function<void()>& work);
+};
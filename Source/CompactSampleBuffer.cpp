@@ -0,0 +1,86 @@
+#include "CompactSampleBuffer.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+CompactSampleBuffer::CompactSampleBuffer(const float* source, int length)
+    : samples((size_t)length),
+      scales((size_t)((length + blockSize - 1) / blockSize)),
+      numSamples(length)
+{
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        const int num = juce::jmin(blockSize, numSamples - start);
+
+        float peak = 0.0f;
+        for (int i = 0; i < num; ++i)
+            peak = juce::jmax(peak, std::abs(source[start + i]));
+
+        // Silent blocks keep a zero scale and decode to zero
+        const float scale = peak / 32767.0f;
+        const float inverse = peak > 0.0f ? 1.0f / scale : 0.0f;
+
+        scales[(size_t)(start / blockSize)] = scale;
+
+        for (int i = 0; i < num; ++i)
+            samples[(size_t)(start + i)] = (juce::int16)juce::jlimit(-32767, 32767, juce::roundToInt(source[start + i] * inverse));
+    }
+}
+
+size_t CompactSampleBuffer::getSizeInBytes() const
+{
+    return samples.size() * sizeof(juce::int16) + scales.size() * sizeof(float);
+}
+
+void CompactSampleBuffer::decode(int start, int num, float* dest) const
+{
+    jassert(start >= 0 && num >= 0 && start + num <= numSamples);
+
+    while (num > 0)
+    {
+        // Decode up to the end of the block, where the scale changes
+        const int block = start / blockSize;
+        const int run = juce::jmin(num, (block + 1) * blockSize - start);
+
+        decodeRun(samples.data() + start, scales[(size_t)block], dest, run);
+
+        start += run;
+        dest += run;
+        num -= run;
+    }
+}
+
+void CompactSampleBuffer::decodeRun(const juce::int16* source, float scale, float* dest, int num) noexcept
+{
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    const __m128 multiplier = _mm_set1_ps(scale);
+
+    for (; i + 8 <= num; i += 8)
+    {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+        // Sign-extend by moving each value into the top half of a 32-bit lane
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(low), multiplier));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), multiplier));
+    }
+#elif JUCE_USE_ARM_NEON
+    for (; i + 8 <= num; i += 8)
+    {
+        const int16x8_t packed = vld1q_s16(source + i);
+
+        vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(packed))), scale));
+        vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(packed))), scale));
+    }
+#endif
+
+    for (; i < num; ++i)
+        dest[i] = (float)source[i] * scale;
+}
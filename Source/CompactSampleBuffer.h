@@ -0,0 +1,36 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Mono sample data held as 16-bit integers with one float scale factor per
+// block of samples: a little over half the memory of float storage. Scaling
+// per block keeps quantisation noise relative to the local level, so quiet
+// tails keep their resolution.
+class CompactSampleBuffer
+{
+public:
+    static constexpr int blockSize = 64;
+
+    CompactSampleBuffer() = default;
+    CompactSampleBuffer(const float* source, int numSamples);
+
+    int getNumSamples() const { return numSamples; }
+    size_t getSizeInBytes() const;
+
+    float getSample(int index) const
+    {
+        jassert(index >= 0 && index < numSamples);
+        return (float)samples[(size_t)index] * scales[(size_t)(index / blockSize)];
+    }
+
+    // Decodes [start, start + num) into dest; the range must lie inside the buffer
+    void decode(int start, int num, float* dest) const;
+
+private:
+    std::vector<juce::int16> samples;
+    std::vector<float> scales;
+    int numSamples = 0;
+
+    static void decodeRun(const juce::int16* source, float scale, float* dest, int num) noexcept;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Approximations for per-span work on the audio thread, where std::pow
+// would cost more than the samples it is computed for.
+namespace FastMath
+{
+    // 2^x, relative error below 2e-7 (well under a thousandth of a cent as a
+    // pitch ratio). x is clamped to the normal float range.
+    inline float exp2(float x) noexcept
+    {
+        x = juce::jlimit(-126.0f, 126.0f, x);
+
+        int whole = (int)x;
+        if ((float)whole > x)
+            --whole;
+
+        const float f = x - (float)whole;
+
+        // Minimax polynomial for 2^f on [0, 1)
+        const float mantissa = 1.0f + f * (0.6931530732f + f * (0.2401536896f + f * (0.0558263180f
+                                    + f * (0.0089893397f + f * 0.0018775767f))));
+
+        // 2^whole straight from the exponent bits
+        const juce::int32 bits = (whole + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+
+        return mantissa * scale;
+    }
+
+    inline float semitonesToRatio(float semitones) noexcept
+    {
+        return exp2(semitones * (1.0f / 12.0f));
+    }
+}
@@ -0,0 +1,128 @@
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(std::vector<AISamplerSound::Ptr> s, double rate, int size)
+    : sounds(std::move(s)), sampleRate(rate), blockSize(juce::jmax(1, size))
+{
+}
+
+RenderStats OfflineRenderer::render(const juce::MidiMessageSequence& sequence,
+                                    juce::AudioFormatWriter* writer,
+                                    double tailSeconds) const
+{
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    AISamplerEngine engine;
+    engine.setCurrentPlaybackSampleRate(sampleRate);
+    engine.loadPreparedSounds(sounds, "Offline");
+
+    const juce::int64 totalSamples = (juce::int64)std::ceil((sequence.getEndTime() + tailSeconds) * sampleRate);
+
+    juce::AudioBuffer<float> block(numOutputChannels, blockSize);
+    juce::MidiBuffer midi;
+    int eventIndex = 0;
+
+    for (juce::int64 position = 0; position < totalSamples; position += blockSize)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)blockSize, totalSamples - position);
+
+        // Gather the events that fall inside this block
+        midi.clear();
+
+        while (eventIndex < sequence.getNumEvents())
+        {
+            const auto& message = sequence.getEventPointer(eventIndex)->message;
+            const auto eventSample = (juce::int64)std::llround(message.getTimeStamp() * sampleRate);
+
+            if (eventSample >= position + numSamples)
+                break;
+
+            if (!message.isMetaEvent())
+                midi.addEvent(message, (int)juce::jmax((juce::int64)0, eventSample - position));
+
+            ++eventIndex;
+        }
+
+        block.clear();
+        engine.renderNextBlock(block, midi, 0, numSamples);
+
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer(block, 0, numSamples);
+    }
+
+    RenderStats stats;
+    stats.audioSeconds = (double)totalSamples / sampleRate;
+    stats.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    return stats;
+}
+
+bool OfflineRenderer::readMidiFile(const juce::File& file,
+                                   std::vector<juce::MidiMessageSequence>& sequences,
+                                   bool splitTracks)
+{
+    juce::FileInputStream stream(file);
+    juce::MidiFile midiFile;
+
+    if (!stream.openedOk() || !midiFile.readFrom(stream))
+    {
+        DBG("Failed to read MIDI file: " + file.getFullPathName());
+        return false;
+    }
+
+    // Tempo maps are applied here, so every timestamp is in seconds
+    midiFile.convertTimestampTicksToSeconds();
+
+    juce::MidiMessageSequence merged;
+
+    for (int t = 0; t < midiFile.getNumTracks(); ++t)
+    {
+        const auto* track = midiFile.getTrack(t);
+
+        if (splitTracks)
+        {
+            // Skip tempo/conductor tracks that carry no notes
+            bool hasNotes = false;
+            for (int i = 0; i < track->getNumEvents() && !hasNotes; ++i)
+                hasNotes = track->getEventPointer(i)->message.isNoteOn();
+
+            if (hasNotes)
+                sequences.push_back(*track);
+        }
+        else
+        {
+            merged.addSequence(*track, 0.0);
+        }
+    }
+
+    if (!splitTracks)
+    {
+        merged.updateMatchedPairs();
+        sequences.push_back(merged);
+    }
+
+    return true;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineRenderer::createWavWriter(const juce::File& file,
+                                                                          double sampleRate,
+                                                                          int numChannels,
+                                                                          int bitsPerSample)
+{
+    file.deleteFile();
+
+    auto stream = file.createOutputStream();
+
+    if (stream == nullptr)
+        return nullptr;
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels, bitsPerSample,
+                                  juce::StringPairArray(), 0));
+
+    // The writer owns the stream once it has been created
+    if (writer != nullptr)
+        stream.release();
+
+    return writer;
+}
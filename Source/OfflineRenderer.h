@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerEngine.h"
+
+//==============================================================================
+struct RenderStats
+{
+    double audioSeconds = 0.0;
+    double renderSeconds = 0.0;
+
+    double getRealtimeFactor() const { return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0; }
+};
+
+//==============================================================================
+// Renders MIDI through AISamplerEngine without a host, as fast as the CPU
+// allows. Each render() call builds its own engine around the shared,
+// read-only sounds, so one renderer can be used from many threads at once.
+class OfflineRenderer
+{
+public:
+    OfflineRenderer(std::vector<AISamplerSound::Ptr> sounds, double sampleRate, int blockSize = 512);
+
+    // Renders a sequence (timestamps in seconds) followed by a release tail.
+    // Blocks are streamed to writer when one is given, otherwise discarded.
+    RenderStats render(const juce::MidiMessageSequence& sequence,
+                       juce::AudioFormatWriter* writer,
+                       double tailSeconds = 2.0) const;
+
+    double getSampleRate() const { return sampleRate; }
+    int getBlockSize() const { return blockSize; }
+
+    // Reads a Standard MIDI File with timestamps converted to seconds: one
+    // sequence per track, or every track merged into one
+    static bool readMidiFile(const juce::File& file,
+                             std::vector<juce::MidiMessageSequence>& sequences,
+                             bool splitTracks);
+
+    // WAV writer for rendered output; 24-bit, or float with bitsPerSample 32
+    static std::unique_ptr<juce::AudioFormatWriter> createWavWriter(const juce::File& file,
+                                                                    double sampleRate,
+                                                                    int numChannels = 2,
+                                                                    int bitsPerSample = 24);
+
+private:
+    std::vector<AISamplerSound::Ptr> sounds;
+    double sampleRate;
+    int blockSize;
+
+    static constexpr int numOutputChannels = 2;
+};
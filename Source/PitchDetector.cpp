@@ -12,27 +12,45 @@ float PitchDetector::detectPitch(const juce::AudioBuffer<float>& buffer, double
     const float* data = buffer.getReadPointer(0);
     int length = juce::jmin(buffer.getNumSamples(), 8192); // Analyze first ~185ms
     
-    // Find the lag with maximum autocorrelation (excluding lag 0)
+    // Correlation at every candidate lag
+    const int numLags = juce::jmin(maxPeriod, length / 2);
+    std::vector<float> correlations((size_t)numLags, 0.0f);
     float maxCorrelation = -1.0f;
+    
+    for (int lag = minPeriod; lag < numLags; ++lag)
+    {
+        correlations[(size_t)lag] = autocorrelate(data, length, lag);
+        maxCorrelation = juce::jmax(maxCorrelation, correlations[(size_t)lag]);
+    }
+    
+    // Require minimum correlation for confidence
+    if (maxCorrelation < 0.3f)
+        return 0.0f;
+    
+    // Every multiple of the period correlates almost as well as the period
+    // itself, so take the first peak close to the best rather than the best
     int bestLag = 0;
     
-    for (int lag = minPeriod; lag < maxPeriod && lag < length / 2; ++lag)
+    for (int lag = minPeriod + 1; lag + 1 < numLags && bestLag == 0; ++lag)
     {
-        float correlation = autocorrelate(data, length, lag);
+        const float c = correlations[(size_t)lag];
         
-        if (correlation > maxCorrelation)
-        {
-            maxCorrelation = correlation;
+        if (c >= peakThreshold * maxCorrelation
+            && c >= correlations[(size_t)lag - 1] && c >= correlations[(size_t)lag + 1])
             bestLag = lag;
-        }
     }
     
-    // Require minimum correlation for confidence
-    if (maxCorrelation < 0.3f || bestLag == 0)
+    if (bestLag == 0)
         return 0.0f;
     
+    // Parabolic interpolation between lags for sub-sample accuracy
+    const float before = correlations[(size_t)bestLag - 1];
+    const float after = correlations[(size_t)bestLag + 1];
+    const float curvature = before - 2.0f * correlations[(size_t)bestLag] + after;
+    const float offset = curvature < 0.0f ? 0.5f * (before - after) / curvature : 0.0f;
+    
     // Convert lag to frequency
-    float frequency = (float)sampleRate / (float)bestLag;
+    float frequency = (float)sampleRate / ((float)bestLag + offset);
     
     return frequency;
 }
@@ -18,4 +18,5 @@ private:
     
     static constexpr int minPeriod = 20;    // ~2200 Hz max
     static constexpr int maxPeriod = 2000;  // ~22 Hz min
+    static constexpr float peakThreshold = 0.9f;    // of the best correlation
 };
@@ -5,7 +5,7 @@
 AIGenVSTEditor::AIGenVSTEditor (AIGenVSTProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
-    setSize (500, 300);
+    setSize (500, 460);
     
     // Title Label
     titleLabel.setText("AI Instrument Generator", juce::dontSendNotification);
@@ -30,6 +30,69 @@ AIGenVSTEditor::AIGenVSTEditor (AIGenVSTProcessor& p)
     promptInput.setColour(juce::TextEditor::outlineColourId, juce::Colour(0xff3a3a3a));
     addAndMakeVisible(promptInput);
     
+    // Multi-sample Toggle
+    multisampleToggle.setButtonText("Multi-sample (one zone per octave)");
+    multisampleToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    multisampleToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    addAndMakeVisible(multisampleToggle);
+    
+    // Variations Toggle
+    variationsToggle.setButtonText("Pre-generate variations");
+    variationsToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    variationsToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    variationsToggle.setToggleState(audioProcessor.getSpeculativeVariations(), juce::dontSendNotification);
+    variationsToggle.onClick = [this] { audioProcessor.setSpeculativeVariations(variationsToggle.getToggleState()); };
+    addAndMakeVisible(variationsToggle);
+    
+    // Time-stretch Toggle
+    timeStretchToggle.setButtonText("Same length on every key (time-stretch)");
+    timeStretchToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    timeStretchToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    timeStretchToggle.setToggleState(audioProcessor.getSampler().getPlaybackMode() == PlaybackMode::timeStretch,
+                                     juce::dontSendNotification);
+    timeStretchToggle.onClick = [this]
+    {
+        audioProcessor.getSampler().setPlaybackMode(timeStretchToggle.getToggleState() ? PlaybackMode::timeStretch
+                                                                                       : PlaybackMode::resample);
+    };
+    addAndMakeVisible(timeStretchToggle);
+    
+    // MPE Toggle
+    mpeToggle.setButtonText("MPE");
+    mpeToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    mpeToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    mpeToggle.setToggleState(audioProcessor.getSampler().isMPEEnabled(), juce::dontSendNotification);
+    mpeToggle.onClick = [this] { audioProcessor.getSampler().setMPEEnabled(mpeToggle.getToggleState()); };
+    addAndMakeVisible(mpeToggle);
+    
+    // Filter: cutoff and resonance; envelope and tracking keep their defaults
+    const auto& filter = audioProcessor.getSampler().getFilterSettings();
+    
+    filterToggle.setButtonText("Filter");
+    filterToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    filterToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    filterToggle.setToggleState(filter.enabled, juce::dontSendNotification);
+    filterToggle.onClick = [this] { updateFilter(); };
+    addAndMakeVisible(filterToggle);
+    
+    cutoffSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    cutoffSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 70, 20);
+    cutoffSlider.setRange(20.0, 20000.0, 1.0);
+    cutoffSlider.setSkewFactorFromMidPoint(1000.0);
+    cutoffSlider.setTextValueSuffix(" Hz");
+    cutoffSlider.setColour(juce::Slider::thumbColourId, accentColour);
+    cutoffSlider.setValue(filter.cutoffHz, juce::dontSendNotification);
+    cutoffSlider.onValueChange = [this] { updateFilter(); };
+    addAndMakeVisible(cutoffSlider);
+    
+    resonanceSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    resonanceSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 50, 20);
+    resonanceSlider.setRange(0.0, 1.0, 0.01);
+    resonanceSlider.setColour(juce::Slider::thumbColourId, accentColour);
+    resonanceSlider.setValue(filter.resonance, juce::dontSendNotification);
+    resonanceSlider.onValueChange = [this] { updateFilter(); };
+    addAndMakeVisible(resonanceSlider);
+    
     // Generate Button
     generateButton.setButtonText("Generate Instrument");
     generateButton.setColour(juce::TextButton::buttonColourId, accentColour);
@@ -37,6 +100,16 @@ AIGenVSTEditor::AIGenVSTEditor (AIGenVSTProcessor& p)
     generateButton.onClick = [this] { generateButtonClicked(); };
     addAndMakeVisible(generateButton);
     
+    // Another Button
+    anotherButton.setButtonText("Another");
+    anotherButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff2a2a2a));
+    anotherButton.setColour(juce::TextButton::textColourOffId, juce::Colours::white);
+    anotherButton.onClick = [this] { anotherButtonClicked(); };
+    addAndMakeVisible(anotherButton);
+    
+    // Waveform
+    addAndMakeVisible(waveformView);
+    
     // Status Label
     statusLabel.setText("Ready", juce::dontSendNotification);
     statusLabel.setFont(juce::Font(12.0f));
@@ -51,12 +124,15 @@ AIGenVSTEditor::AIGenVSTEditor (AIGenVSTProcessor& p)
     infoLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
     addAndMakeVisible(infoLabel);
     
-    // Start timer for status updates
-    startTimer(100); // Update 10 times per second
+    // Refresh when the processor reports a change; the timer only runs
+    // while notes sound, to move the playheads
+    audioProcessor.addChangeListener(this);
+    updateFromProcessor();
 }
 
 AIGenVSTEditor::~AIGenVSTEditor()
 {
+    audioProcessor.removeChangeListener(this);
     stopTimer();
 }
 
@@ -81,10 +157,32 @@ void AIGenVSTEditor::resized()
     area.removeFromTop(5);
     
     promptInput.setBounds(area.removeFromTop(30));
-    area.removeFromTop(15);
+    area.removeFromTop(5);
+    
+    auto toggleRow = area.removeFromTop(25);
+    variationsToggle.setBounds(toggleRow.removeFromRight(180));
+    multisampleToggle.setBounds(toggleRow);
+    area.removeFromTop(5);
+    
+    auto modeRow = area.removeFromTop(25);
+    mpeToggle.setBounds(modeRow.removeFromRight(180));
+    timeStretchToggle.setBounds(modeRow);
+    area.removeFromTop(5);
     
-    generateButton.setBounds(area.removeFromTop(40));
-    area.removeFromTop(15);
+    auto filterRow = area.removeFromTop(25);
+    filterToggle.setBounds(filterRow.removeFromLeft(80));
+    resonanceSlider.setBounds(filterRow.removeFromRight(150));
+    cutoffSlider.setBounds(filterRow);
+    area.removeFromTop(5);
+    
+    auto buttonRow = area.removeFromTop(40);
+    anotherButton.setBounds(buttonRow.removeFromRight(110));
+    buttonRow.removeFromRight(10);
+    generateButton.setBounds(buttonRow);
+    area.removeFromTop(10);
+    
+    waveformView.setBounds(area.removeFromTop(90));
+    area.removeFromTop(10);
     
     statusLabel.setBounds(area.removeFromTop(25));
     area.removeFromTop(5);
@@ -92,21 +190,82 @@ void AIGenVSTEditor::resized()
     infoLabel.setBounds(area.removeFromTop(20));
 }
 
+void AIGenVSTEditor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    updateFromProcessor();
+}
+
 void AIGenVSTEditor::timerCallback()
 {
-    // Update status from processor
-    statusLabel.setText(audioProcessor.getGenerationStatus(), juce::dontSendNotification);
+    updatePlayheads();
+}
+
+void AIGenVSTEditor::updatePlayheads()
+{
+    int positions[WaveformView::maxPlayheads];
+    const int numPositions = audioProcessor.getSampler().getPlayPositions(waveformView.getSound(), positions,
+                                                                          WaveformView::maxPlayheads);
+    waveformView.setPlayPositions(positions, numPositions);
+}
+
+void AIGenVSTEditor::updateFromProcessor()
+{
+    // Update status from processor; while idle, surface model loading progress
+    auto backendStatus = audioProcessor.getBackendStatus();
+    
+    if (!audioProcessor.isGenerating() && !backendStatus.ready)
+        statusLabel.setText(backendStatus.describe(), juce::dontSendNotification);
+    else if (audioProcessor.getGenerationStatus().isNotEmpty())
+        statusLabel.setText(audioProcessor.getGenerationStatus(), juce::dontSendNotification);
+    else
+        statusLabel.setText("Ready", juce::dontSendNotification);
     
     // Update button state
     generateButton.setEnabled(!audioProcessor.isGenerating());
+    anotherButton.setEnabled(!audioProcessor.isGenerating() && audioProcessor.canPlayVariation());
+    
+    const int numReady = audioProcessor.getNumReadyVariations();
+    anotherButton.setButtonText(numReady > 0 ? "Another (" + juce::String(numReady) + ")" : juce::String("Another"));
+    
+    // Log quality changes; show the level while it is reduced
+    auto& governor = audioProcessor.getQualityGovernor();
+    QualityGovernor::Event events[16];
+    
+    int numEvents;
+    
+    while ((numEvents = governor.readEvents(events, 16)) > 0)
+        for (int i = 0; i < numEvents; ++i)
+            DBG(juce::String("Render quality ") + QualityGovernor::getLevelName(events[i].from) + " -> "
+                + QualityGovernor::getLevelName(events[i].to) + " at load " + juce::String(events[i].load, 2));
     
     // Update info label
     if (audioProcessor.getSampler().hasSampleLoaded())
     {
-        infoLabel.setText(audioProcessor.getSampler().getLoadedSampleInfo(), juce::dontSendNotification);
+        auto info = audioProcessor.getSampler().getLoadedSampleInfo();
+        
+        if (governor.getLevel() != QualityGovernor::Level::full)
+            info += juce::String(" | Reduced quality: ") + QualityGovernor::getLevelName(governor.getLevel());
+        
+        infoLabel.setText(info, juce::dontSendNotification);
         infoLabel.setColour(juce::Label::textColourId, accentColour);
     }
     
+    // Middle C's zone stands for a multi-sample instrument
+    waveformView.setSound(audioProcessor.getSampler().getSoundForNote(60));
+    
+    // Animate playheads only while something sounds
+    if (audioProcessor.isPlaying())
+    {
+        if (!isTimerRunning())
+            startTimerHz(playheadRefreshHz);
+    }
+    else
+    {
+        stopTimer();
+    }
+    
+    updatePlayheads();
+    
     // Change button color when generating
     if (audioProcessor.isGenerating())
     {
@@ -134,5 +293,22 @@ void AIGenVSTEditor::generateButtonClicked()
     }
     
     // Trigger generation in processor
-    audioProcessor.generateInstrumentFromPrompt(prompt, 3.0f);
+    if (multisampleToggle.getToggleState())
+        audioProcessor.generateMultisampleFromPrompt(prompt, 3.0f, multisampleZones);
+    else
+        audioProcessor.generateInstrumentFromPrompt(prompt, 3.0f);
+}
+
+void AIGenVSTEditor::anotherButtonClicked()
+{
+    audioProcessor.playNextVariation();
+}
+
+void AIGenVSTEditor::updateFilter()
+{
+    auto settings = audioProcessor.getSampler().getFilterSettings();
+    settings.enabled = filterToggle.getToggleState();
+    settings.cutoffHz = (float)cutoffSlider.getValue();
+    settings.resonance = (float)resonanceSlider.getValue();
+    audioProcessor.getSampler().setFilterSettings(settings);
 }
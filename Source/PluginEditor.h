@@ -2,9 +2,11 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "WaveformView.h"
 
 //==============================================================================
 class AIGenVSTEditor : public juce::AudioProcessorEditor,
+                       private juce::ChangeListener,
                        private juce::Timer
 {
 public:
@@ -16,8 +18,13 @@ public:
     void resized() override;
 
 private:
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     void timerCallback() override;
+    void updateFromProcessor();
+    void updatePlayheads();
     void generateButtonClicked();
+    void anotherButtonClicked();
+    void updateFilter();
     
     AIGenVSTProcessor& audioProcessor;
     
@@ -25,10 +32,22 @@ private:
     juce::Label titleLabel;
     juce::Label promptLabel;
     juce::TextEditor promptInput;
+    juce::ToggleButton multisampleToggle;
+    juce::ToggleButton variationsToggle;
+    juce::ToggleButton timeStretchToggle;
+    juce::ToggleButton mpeToggle;
+    juce::ToggleButton filterToggle;
+    juce::Slider cutoffSlider;
+    juce::Slider resonanceSlider;
     juce::TextButton generateButton;
+    juce::TextButton anotherButton;
+    WaveformView waveformView;
     juce::Label statusLabel;
     juce::Label infoLabel;
     
+    static constexpr int multisampleZones = 8;
+    static constexpr int playheadRefreshHz = 30;
+    
     // Styling
     juce::Colour backgroundColour = juce::Colour(0xff1a1a1a);
     juce::Colour accentColour = juce::Colour(0xff4CAF50);
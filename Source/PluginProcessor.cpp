@@ -6,15 +6,24 @@ AIGenVSTProcessor::AIGenVSTProcessor()
      : AudioProcessor (BusesProperties()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
 {
+    backendMonitor.addChangeListener(this);
+    variations.addChangeListener(this);
+    backendMonitor.startThread();
 }
 
 AIGenVSTProcessor::~AIGenVSTProcessor()
 {
+    cancelPendingUpdate();
+    backendMonitor.removeChangeListener(this);
+    variations.removeChangeListener(this);
+    
     if (generationThread != nullptr)
     {
         generationThread->stopThread(5000);
         generationThread.reset();
     }
+    
+    backendMonitor.stopThread(3000);
 }
 
 //==============================================================================
@@ -73,6 +82,9 @@ void AIGenVSTProcessor::changeProgramName (int index, const juce::String& newNam
 void AIGenVSTProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     sampler.setCurrentPlaybackSampleRate(sampleRate);
+    
+    qualityGovernor.reset();
+    qualityGovernor.apply(sampler);
 }
 
 void AIGenVSTProcessor::releaseResources()
@@ -97,8 +109,29 @@ void AIGenVSTProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Mi
     // Clear output buffer
     buffer.clear();
     
-    // Render sampler
+    // Render sampler, timed against the time the host has for this block
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    
     sampler.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    
+    const double renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    
+    if (getSampleRate() > 0.0)
+    {
+        qualityGovernor.update(renderSeconds, buffer.getNumSamples() / getSampleRate());
+        qualityGovernor.apply(sampler);
+    }
+    
+    // Wake the editor on transitions only, never every block
+    const bool nowPlaying = sampler.isAnyVoiceActive();
+    const auto qualityLevel = qualityGovernor.getLevel();
+    
+    if (nowPlaying != playing.load() || qualityLevel != lastQualityLevel)
+    {
+        playing.store(nowPlaying);
+        lastQualityLevel = qualityLevel;
+        triggerAsyncUpdate();
+    }
 }
 
 //==============================================================================
@@ -127,6 +160,49 @@ void AIGenVSTProcessor::setStateInformation (const void* data, int sizeInBytes)
 
 //==============================================================================
 void AIGenVSTProcessor::generateInstrumentFromPrompt(const juce::String& prompt, float duration)
+{
+    startGeneration(prompt, duration, 1);
+}
+
+void AIGenVSTProcessor::generateMultisampleFromPrompt(const juce::String& prompt, float duration,
+                                                      int numZones)
+{
+    startGeneration(prompt, duration, juce::jlimit(1, 10, numZones));
+}
+
+void AIGenVSTProcessor::setSpeculativeVariations(bool shouldSpeculate)
+{
+    speculativeVariations.store(shouldSpeculate);
+    
+    if (!shouldSpeculate)
+        variations.clear();
+    else if (lastPrompt.isNotEmpty() && !generating.load() && sampler.hasSampleLoaded())
+        variations.start(lastPrompt, lastDuration, getGenerationSampleRate(), sampler.isCompactSampleStorage());
+}
+
+void AIGenVSTProcessor::playNextVariation()
+{
+    if (generating.load() || lastPrompt.isEmpty())
+        return;
+    
+    VariationPregenerator::Variation variation;
+    
+    if (variations.takeReady(variation))
+    {
+        sampler.loadPreparedSounds({ variation.sound }, variation.info);
+        setGenerationStatus("Ready! Play MIDI notes.");
+        
+        // The status may not have changed, the sound has
+        sendChangeMessage();
+        return;
+    }
+    
+    // Nothing ready yet: generate one in the foreground
+    const int seed = juce::Random::getSystemRandom().nextInt(std::numeric_limits<int>::max());
+    startGeneration(lastPrompt, lastDuration, 1, seed);
+}
+
+void AIGenVSTProcessor::startGeneration(const juce::String& prompt, float duration, int numZones, int seed)
 {
     if (generating.load())
     {
@@ -134,6 +210,15 @@ void AIGenVSTProcessor::generateInstrumentFromPrompt(const juce::String& prompt,
         return;
     }
     
+    // A new prompt makes the pre-generated variations useless; any request
+    // in flight is cancelled by the backend once ours arrives
+    if (prompt != lastPrompt || numZones > 1)
+        variations.clear();
+    
+    variations.setPaused(true);
+    lastPrompt = numZones == 1 ? prompt : juce::String();
+    lastDuration = duration;
+    
     // Stop any existing thread
     if (generationThread != nullptr)
     {
@@ -143,46 +228,230 @@ void AIGenVSTProcessor::generateInstrumentFromPrompt(const juce::String& prompt,
     
     // Start new generation thread
     generating.store(true);
-    generationStatus = "Starting generation...";
+    setGenerationStatus("Starting generation...");
     
-    generationThread = std::make_unique<GenerationThread>(*this, prompt, duration);
+    generationThread = std::make_unique<GenerationThread>(*this, prompt, duration, numZones, seed);
     generationThread->startThread();
 }
 
-void AIGenVSTProcessor::runGeneration(const juce::String& prompt, float duration)
+void AIGenVSTProcessor::runGeneration(const juce::String& prompt, float duration, int numZones, int seed)
 {
     try
     {
-        generationStatus = "Calling AI model...";
+        // Play the closest earlier result straight away; the real
+        // generation replaces it when it arrives. A variation of the
+        // current prompt keeps playing the current sample instead.
+        const auto instantMatch = numZones == 1 && seed < 0 ? loadInstantMatch(prompt) : juce::String();
+        
+        // Wait for the model to finish loading so the request timeout only
+        // ever covers inference time
+        if (!waitForBackendReady())
+        {
+            finishGeneration();
+            return;
+        }
+        
+        if (numZones > 1)
+        {
+            runMultisampleGeneration(prompt, duration, numZones);
+            finishGeneration();
+            return;
+        }
+        
+        setGenerationStatus(instantMatch.isNotEmpty() ? "Playing \"" + instantMatch + "\", generating..."
+                                                      : juce::String("Calling AI model..."));
         
         // Call AI generator
-        auto result = aiGenerator.generate(prompt, duration);
+        GenerationOptions options;
+        options.seed = seed;
+        
+        auto result = aiGenerator.generate(prompt, duration, getGenerationSampleRate(), options);
         
         if (result.success)
         {
-            generationStatus = "Processing audio...";
+            setGenerationStatus("Processing audio...");
+            
+            // Load the generated WAV into sampler, reusing the backend's
+            // analysis when it matches the file
+            sampler.loadSampleFromFile(result.wavFilePath, result.analysis);
+            cacheGeneratedSample(prompt, juce::File(result.wavFilePath));
             
-            // Load the generated WAV into sampler
-            sampler.loadSampleFromFile(result.wavFilePath);
+            // Only now, so speculation never competes with this request
+            if (speculativeVariations.load() && seed < 0)
+                variations.start(prompt, duration, getGenerationSampleRate(), sampler.isCompactSampleStorage());
             
-            generationStatus = "Ready! Play MIDI notes.";
+            setGenerationStatus("Ready! Play MIDI notes.");
             
             // Clean up temp file (optional)
             // juce::File(result.wavFilePath).deleteFile();
         }
         else
         {
-            generationStatus = "Error: " + result.errorMessage;
+            setGenerationStatus("Error: " + result.errorMessage);
             DBG("Generation failed: " + result.errorMessage);
         }
     }
     catch (const std::exception& e)
     {
-        generationStatus = "Exception: " + juce::String(e.what());
+        setGenerationStatus("Exception: " + juce::String(e.what()));
         DBG("Exception during generation: " + juce::String(e.what()));
     }
     
+    finishGeneration();
+}
+
+void AIGenVSTProcessor::finishGeneration()
+{
     generating.store(false);
+    variations.setPaused(false);
+    sendChangeMessage();
+}
+
+juce::String AIGenVSTProcessor::getGenerationStatus() const
+{
+    const juce::ScopedLock sl(statusLock);
+    return generationStatus;
+}
+
+void AIGenVSTProcessor::setGenerationStatus(const juce::String& newStatus)
+{
+    {
+        const juce::ScopedLock sl(statusLock);
+        
+        if (newStatus == generationStatus)
+            return;
+        
+        generationStatus = newStatus;
+    }
+    
+    // Asynchronous, so safe from the generation thread
+    sendChangeMessage();
+}
+
+void AIGenVSTProcessor::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    sendSynchronousChangeMessage();
+}
+
+void AIGenVSTProcessor::handleAsyncUpdate()
+{
+    sendSynchronousChangeMessage();
+}
+
+void AIGenVSTProcessor::runMultisampleGeneration(const juce::String& prompt, float duration, int numZones)
+{
+    // One zone per octave, centred on the middle of the keyboard
+    juce::Array<int> zoneNotes;
+    const int firstNote = 60 - 12 * (numZones / 2);
+    
+    for (int i = 0; i < numZones; ++i)
+        zoneNotes.add(juce::jlimit(0, 127, firstNote + 12 * i));
+    
+    setGenerationStatus("Calling AI model (" + juce::String(numZones) + " zones)...");
+    
+    auto result = aiGenerator.generateBatch(prompt, zoneNotes, duration, getGenerationSampleRate());
+    
+    if (!result.success)
+    {
+        setGenerationStatus("Error: " + result.errorMessage);
+        DBG("Batch generation failed: " + result.errorMessage);
+        return;
+    }
+    
+    setGenerationStatus("Analysing " + juce::String(numZones) + " zones...");
+    
+    if (sampler.loadMultisampleFromFiles(result.wavFilePaths, result.midiNotes, result.analyses))
+        setGenerationStatus("Ready! Play MIDI notes.");
+    else
+        setGenerationStatus("Error: could not load generated zones");
+}
+
+AIGenVSTProcessor::SharedPromptIndex::SharedPromptIndex()
+    : sampleDirectory(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                          .getChildFile("AIGenVST").getChildFile("PromptCache").getChildFile("Samples")),
+      index(sampleDirectory.getParentDirectory())
+{
+    sampleDirectory.createDirectory();
+}
+
+juce::String AIGenVSTProcessor::loadInstantMatch(const juce::String& prompt)
+{
+    const auto match = promptCache->index.findNearest(prompt, instantMatchSimilarity);
+    
+    if (!match.found || !match.sampleFile.existsAsFile())
+        return {};
+    
+    sampler.loadSampleFromFile(match.sampleFile.getFullPathName());
+    setGenerationStatus("Playing \"" + match.prompt + "\"");
+    
+    DBG("Instant match for \"" + prompt + "\": \"" + match.prompt + "\" ("
+        + juce::String(match.similarity, 2) + ")");
+    return match.prompt;
+}
+
+void AIGenVSTProcessor::cacheGeneratedSample(const juce::String& prompt, const juce::File& wavFile)
+{
+    // The backend writes to a temp directory, so keep a copy of our own,
+    // one per distinct prompt
+    const auto normalised = PromptIndex::normalisePrompt(prompt);
+    const auto cachedFile = promptCache->sampleDirectory.getChildFile(
+        juce::String::toHexString(normalised.hashCode64()) + ".wav");
+    
+    if (normalised.isNotEmpty() && wavFile.copyFileTo(cachedFile))
+        promptCache->index.add(normalised, cachedFile);
+}
+
+double AIGenVSTProcessor::getGenerationSampleRate() const
+{
+    // Have the backend write samples at the host rate so voices never
+    // resample between rates, only for pitch
+    return getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+}
+
+bool AIGenVSTProcessor::waitForBackendReady()
+{
+    // Only trust a poll made after this point, the cached one may be stale
+    const int firstFreshPoll = backendMonitor.getPollCount() + 1;
+    backendMonitor.notify();
+    
+    // A load that hangs (or a backend stuck reporting "loading") must not
+    // hold the generation thread forever
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)backendReadyTimeoutMs;
+    
+    for (;;)
+    {
+        if (juce::Thread::currentThreadShouldExit())
+            return false;
+        
+        BackendStatus status;
+        const bool polled = backendMonitor.getPollCount() >= firstFreshPoll;
+        
+        if (polled)
+        {
+            status = backendMonitor.getStatus();
+            
+            if (status.ready)
+                return true;
+            
+            if (!status.reachable || status.state == "error")
+            {
+                setGenerationStatus("Error: " + status.describe());
+                return false;
+            }
+            
+            setGenerationStatus(status.describe());
+        }
+        
+        if ((juce::int32)(juce::Time::getMillisecondCounter() - deadline) >= 0)
+        {
+            setGenerationStatus("Error: backend not ready after "
+                                + juce::String(backendReadyTimeoutMs / 60000) + " minutes"
+                                + (polled ? " (" + status.describe() + ")" : juce::String()));
+            return false;
+        }
+        
+        juce::Thread::sleep(100);
+    }
 }
 
 //==============================================================================
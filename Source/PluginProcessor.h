@@ -3,9 +3,17 @@
 #include <JuceHeader.h>
 #include "SamplerEngine.h"
 #include "AIGenerator.h"
+#include "PromptIndex.h"
+#include "QualityGovernor.h"
+#include "VariationPregenerator.h"
 
 //==============================================================================
-class AIGenVSTProcessor : public juce::AudioProcessor
+// Broadcasts a change whenever anything the editor shows changes: status,
+// backend readiness, ready variations, play state or render quality.
+class AIGenVSTProcessor : public juce::AudioProcessor,
+                          public juce::ChangeBroadcaster,
+                          private juce::ChangeListener,
+                          private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -47,42 +55,174 @@ public:
     //==============================================================================
     // Custom methods for AI generation
     void generateInstrumentFromPrompt(const juce::String& prompt, float duration = 3.0f);
+    
+    // Generates one sample per octave in a single batched backend call and
+    // maps them onto key zones
+    void generateMultisampleFromPrompt(const juce::String& prompt, float duration = 3.0f,
+                                       int numZones = 8);
+    
+    // Swaps in a pre-generated variation of the last prompt, or generates
+    // one with a fresh seed if none is ready
+    void playNextVariation();
+    bool canPlayVariation() const { return lastPrompt.isNotEmpty(); }
+    
+    // Opt-in: spend idle backend time generating variations ahead
+    void setSpeculativeVariations(bool shouldSpeculate);
+    bool getSpeculativeVariations() const { return speculativeVariations.load(); }
+    int getNumReadyVariations() const { return variations.getNumReady(); }
+    
     bool isGenerating() const { return generating.load(); }
-    juce::String getGenerationStatus() const { return generationStatus; }
+    juce::String getGenerationStatus() const;
+    
+    // True while any voice sounds, as of the last block
+    bool isPlaying() const { return playing.load(); }
+    
+    // Latest backend readiness, polled in the background
+    BackendStatus getBackendStatus() const { return backendMonitor.getStatus(); }
+    bool isBackendReady() const { return backendMonitor.getStatus().ready; }
     
     // Access to sampler for UI
     AISamplerEngine& getSampler() { return sampler; }
+    
+    // Render load and quality level telemetry
+    QualityGovernor& getQualityGovernor() { return qualityGovernor; }
 
 private:
     //==============================================================================
     AISamplerEngine sampler;
     AIGenerator aiGenerator;
+    QualityGovernor qualityGovernor;
     
     std::atomic<bool> generating { false };
     juce::String generationStatus;
+    juce::CriticalSection statusLock;
+    
+    // Audio thread state, compared each block to spot transitions
+    std::atomic<bool> playing { false };
+    QualityGovernor::Level lastQualityLevel = QualityGovernor::Level::full;
     
     // Background thread for AI generation
     class GenerationThread : public juce::Thread
     {
     public:
-        GenerationThread(AIGenVSTProcessor& p, const juce::String& prompt, float duration)
-            : Thread("AI Generation"), processor(p), promptText(prompt), audioDuration(duration)
+        GenerationThread(AIGenVSTProcessor& p, const juce::String& prompt, float duration, int zones,
+                         int seedToUse)
+            : Thread("AI Generation"), processor(p), promptText(prompt), audioDuration(duration),
+              numZones(zones), seed(seedToUse)
         {}
         
         void run() override
         {
-            processor.runGeneration(promptText, audioDuration);
+            processor.runGeneration(promptText, audioDuration, numZones, seed);
         }
         
     private:
         AIGenVSTProcessor& processor;
         juce::String promptText;
         float audioDuration;
+        int numZones;
+        int seed;
     };
     
     std::unique_ptr<GenerationThread> generationThread;
     
-    void runGeneration(const juce::String& prompt, float duration);
+    // Polls GET /health on its own connection so readiness is known before
+    // the user clicks Generate, without blocking behind a running request
+    class BackendMonitorThread : public juce::Thread,
+                                 public juce::ChangeBroadcaster
+    {
+    public:
+        BackendMonitorThread() : Thread("AI Backend Monitor") {}
+        
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                auto status = client.getBackendStatus();
+                bool changed;
+                
+                {
+                    const juce::ScopedLock sl(statusLock);
+                    changed = status.ready != latestStatus.ready || status.describe() != latestStatus.describe();
+                    latestStatus = status;
+                }
+                
+                ++pollCount;
+                
+                if (changed)
+                    sendChangeMessage();
+                
+                // Poll quickly while the model loads, then back off
+                wait(status.ready ? readyPollIntervalMs : loadingPollIntervalMs);
+            }
+        }
+        
+        BackendStatus getStatus() const
+        {
+            const juce::ScopedLock sl(statusLock);
+            return latestStatus;
+        }
+        
+        // Incremented after every completed poll
+        int getPollCount() const { return pollCount.load(); }
+        
+    private:
+        static constexpr int loadingPollIntervalMs = 500;
+        static constexpr int readyPollIntervalMs = 5000;
+        
+        AIGenerator client;
+        juce::CriticalSection statusLock;
+        BackendStatus latestStatus;
+        std::atomic<int> pollCount { 0 };
+    };
+    
+    BackendMonitorThread backendMonitor;
+    
+    // Past prompts and copies of their samples, shared by every plugin
+    // instance in the process
+    struct SharedPromptIndex
+    {
+        SharedPromptIndex();
+        
+        juce::File sampleDirectory;
+        PromptIndex index;
+    };
+    
+    juce::SharedResourcePointer<SharedPromptIndex> promptCache;
+    
+    // Cosine similarity above which an earlier sample is played while the
+    // new one generates
+    static constexpr float instantMatchSimilarity = 0.8f;
+    
+    // Loads the best earlier match, returning its prompt (empty if none)
+    juce::String loadInstantMatch(const juce::String& prompt);
+    void cacheGeneratedSample(const juce::String& prompt, const juce::File& wavFile);
+    
+    // Seeds of the current single-sample prompt, generated while idle
+    VariationPregenerator variations;
+    std::atomic<bool> speculativeVariations { false };
+    
+    // Last single-sample request, for "Another" (message thread only)
+    juce::String lastPrompt;
+    float lastDuration = 3.0f;
+    
+    void startGeneration(const juce::String& prompt, float duration, int numZones, int seed = -1);
+    void runGeneration(const juce::String& prompt, float duration, int numZones, int seed);
+    void runMultisampleGeneration(const juce::String& prompt, float duration, int numZones);
+    void finishGeneration();
+    void setGenerationStatus(const juce::String& newStatus);
+    
+    // Blocks the generation thread until the model is loaded; gives up with
+    // an error status after backendReadyTimeoutMs of loading
+    bool waitForBackendReady();
+    static constexpr int backendReadyTimeoutMs = 5 * 60 * 1000;
+    double getGenerationSampleRate() const;
+    
+    // Backend and variation changes are passed on to the editor
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+    
+    // Play and quality transitions, posted from the audio thread
+    void handleAsyncUpdate() override;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AIGenVSTProcessor)
 };
@@ -0,0 +1,419 @@
+#include "PromptIndex.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    const char* const fileMagic = "PIDX";
+
+    int dotProduct(const juce::int8* a, const juce::int8* b) noexcept
+    {
+        int sum = 0;
+        for (int d = 0; d < PromptIndex::dimensions; ++d)
+            sum += (int)a[d] * (int)b[d];
+        return sum;
+    }
+
+    // Best entry among count contiguous vectors, updating best/bestScore
+    void scan(const juce::int8* query, const juce::int8* vectors, int count, int firstIndex,
+              int& best, int& bestScore) noexcept
+    {
+        constexpr int dimensions = PromptIndex::dimensions;
+        int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+        static_assert(dimensions % 16 == 0, "SSE scan works on 16-byte chunks");
+
+        // The query is sign-extended to 16 bits once; each entry is widened
+        // as it is read and multiplied pairwise with madd
+        const __m128i zero = _mm_setzero_si128();
+        __m128i wideQuery[dimensions / 8];
+
+        for (int k = 0; k < dimensions / 16; ++k)
+        {
+            const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(query + k * 16));
+            const __m128i sign = _mm_cmpgt_epi8(zero, q);
+            wideQuery[2 * k] = _mm_unpacklo_epi8(q, sign);
+            wideQuery[2 * k + 1] = _mm_unpackhi_epi8(q, sign);
+        }
+
+        auto partialSums = [&](const juce::int8* entry)
+        {
+            __m128i sum = zero;
+
+            for (int k = 0; k < dimensions / 16; ++k)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(entry + k * 16));
+                const __m128i sign = _mm_cmpgt_epi8(zero, v);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(wideQuery[2 * k], _mm_unpacklo_epi8(v, sign)));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(wideQuery[2 * k + 1], _mm_unpackhi_epi8(v, sign)));
+            }
+
+            return sum;
+        };
+
+        // Four entries at a time, so one transpose finishes all four
+        // horizontal sums
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto* entry = vectors + (size_t)i * dimensions;
+            const __m128i s0 = partialSums(entry);
+            const __m128i s1 = partialSums(entry + dimensions);
+            const __m128i s2 = partialSums(entry + 2 * dimensions);
+            const __m128i s3 = partialSums(entry + 3 * dimensions);
+
+            const __m128i t0 = _mm_unpacklo_epi32(s0, s1);
+            const __m128i t1 = _mm_unpackhi_epi32(s0, s1);
+            const __m128i t2 = _mm_unpacklo_epi32(s2, s3);
+            const __m128i t3 = _mm_unpackhi_epi32(s2, s3);
+            const __m128i totals = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2)),
+                                                 _mm_add_epi32(_mm_unpacklo_epi64(t1, t3), _mm_unpackhi_epi64(t1, t3)));
+
+            alignas(16) int scores[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(scores), totals);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                if (scores[j] > bestScore)
+                {
+                    bestScore = scores[j];
+                    best = firstIndex + i + j;
+                }
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            const int score = dotProduct(query, vectors + (size_t)i * dimensions);
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = firstIndex + i;
+            }
+        }
+    }
+}
+
+//==============================================================================
+PromptIndex::PromptIndex(const juce::File& dir)
+    : directory(dir),
+      fileLock("AIGenPromptIndex_" + juce::String::toHexString(dir.getFullPathName().hashCode64()))
+{
+    load();
+}
+
+PromptIndex::~PromptIndex() = default;
+
+int PromptIndex::size() const
+{
+    const juce::ScopedLock sl(lock);
+    return prompts.size();
+}
+
+juce::String PromptIndex::normalisePrompt(const juce::String& prompt)
+{
+    // Lower case, words separated by single spaces, punctuation dropped
+    juce::String result;
+    bool pendingSpace = false;
+
+    for (int i = 0; i < prompt.length(); ++i)
+    {
+        const auto c = juce::CharacterFunctions::toLowerCase(prompt[i]);
+
+        if (juce::CharacterFunctions::isLetterOrDigit(c))
+        {
+            if (pendingSpace && result.isNotEmpty())
+                result += " ";
+
+            result += juce::String::charToString(c);
+            pendingSpace = false;
+        }
+        else
+        {
+            pendingSpace = true;
+        }
+    }
+
+    return result;
+}
+
+PromptIndex::Vector PromptIndex::embed(const juce::String& prompt)
+{
+    std::array<float, dimensions> accumulator {};
+
+    // Signed feature hashing: collisions cancel out on average instead of
+    // piling up
+    auto addFeature = [&accumulator](const juce::String& feature, float weight)
+    {
+        juce::uint32 hash = 2166136261u;    // FNV-1a
+
+        for (auto* p = feature.toRawUTF8(); *p != 0; ++p)
+            hash = (hash ^ (juce::uint8)*p) * 16777619u;
+
+        accumulator[hash % dimensions] += (hash & 0x80000000u) != 0 ? -weight : weight;
+    };
+
+    // Whole words make the vector independent of word order; trigrams
+    // inside each word tolerate typos and plurals
+    for (auto& word : juce::StringArray::fromTokens(normalisePrompt(prompt), " ", ""))
+    {
+        addFeature(word, 1.0f);
+
+        const auto padded = " " + word + " ";
+        for (int i = 0; i + 3 <= padded.length(); ++i)
+            addFeature(padded.substring(i, i + 3), 0.5f);
+    }
+
+    float norm = 0.0f;
+    for (auto value : accumulator)
+        norm += value * value;
+
+    Vector vector {};
+
+    if (norm > 0.0f)
+    {
+        const float scale = 127.0f / std::sqrt(norm);
+
+        for (int d = 0; d < dimensions; ++d)
+            vector[(size_t)d] = (juce::int8)juce::jlimit(-127, 127, juce::roundToInt(accumulator[(size_t)d] * scale));
+    }
+
+    return vector;
+}
+
+//==============================================================================
+void PromptIndex::add(const juce::String& prompt, const juce::File& sampleFile)
+{
+    const auto normalised = normalisePrompt(prompt);
+
+    if (normalised.isEmpty())
+        return;
+
+    const juce::ScopedLock sl(lock);
+
+    if (!knownPrompts.insert(normalised).second)
+        return;
+
+    const auto vector = embed(normalised);
+    addedVectors.insert(addedVectors.end(), vector.begin(), vector.end());
+    prompts.add(normalised);
+    sampleFiles.add(sampleFile.getFullPathName());
+
+    if (!readOnly && !append(sampleFile.getFullPathName() + "\t" + normalised, vector))
+        DBG("Failed to store prompt in index: " + directory.getFullPathName());
+}
+
+bool PromptIndex::append(const juce::String& entry, const Vector& vector)
+{
+    const juce::InterProcessLock::ScopedLockType filesLocked(fileLock);
+
+    if (!filesLocked.isLocked())
+        return false;
+
+    // Opened per entry: another process may have merged and deleted the
+    // pending file since the last one. FileOutputStream appends. New
+    // vectors never go to the mapped prompts.vec, as Windows refuses
+    // writes to a file while it is mapped.
+    juce::FileOutputStream entryStream(directory.getChildFile("prompts.tsv"));
+    juce::FileOutputStream vectorStream(directory.getChildFile("prompts.pending.vec"));
+
+    if (entryStream.failedToOpen() || vectorStream.failedToOpen())
+        return false;
+
+    // The entry line goes first: a crash in between leaves a line without
+    // a vector, which load() drops
+    entryStream << entry << "\n";
+    entryStream.flush();
+
+    vectorStream.write(vector.data(), vector.size());
+    vectorStream.flush();
+
+    return entryStream.getStatus().wasOk() && vectorStream.getStatus().wasOk();
+}
+
+PromptIndex::Match PromptIndex::findNearest(const juce::String& prompt, float minSimilarity) const
+{
+    const auto query = embed(prompt);
+
+    const juce::ScopedLock sl(lock);
+
+    int best = -1;
+    int bestScore = std::numeric_limits<int>::min();
+
+    if (numMappedVectors > 0)
+        scan(query.data(), getVector(0), numMappedVectors, 0, best, bestScore);
+
+    scan(query.data(), addedVectors.data(), (int)(addedVectors.size() / dimensions), numMappedVectors,
+         best, bestScore);
+
+    Match match;
+
+    if (best >= 0)
+    {
+        match.similarity = (float)bestScore / (127.0f * 127.0f);
+        match.found = match.similarity >= minSimilarity;
+        match.prompt = prompts[best];
+        match.sampleFile = juce::File(sampleFiles[best]);
+    }
+
+    return match;
+}
+
+const juce::int8* PromptIndex::getVector(int index) const
+{
+    if (index < numMappedVectors)
+        return static_cast<const juce::int8*>(mappedVectors->getData()) + headerSize + (size_t)index * dimensions;
+
+    return addedVectors.data() + (size_t)(index - numMappedVectors) * dimensions;
+}
+
+//==============================================================================
+void PromptIndex::load()
+{
+    directory.createDirectory();
+
+    // Nothing may be appended while the files are merged or rewritten
+    const juce::InterProcessLock::ScopedLockType filesLocked(fileLock);
+
+    const auto vectorFile = directory.getChildFile("prompts.vec");
+    const auto pendingFile = directory.getChildFile("prompts.pending.vec");
+    const auto entryFile = directory.getChildFile("prompts.tsv");
+
+    juce::StringArray lines;
+    if (entryFile.existsAsFile())
+        lines = juce::StringArray::fromLines(entryFile.loadFileAsString());
+
+    lines.removeEmptyStrings();
+
+    const bool hasVectorFile = vectorFile.existsAsFile();
+
+    // Vectors added since the last open were written beside the mapped
+    // file; fold them in before it is mapped again. If that fails (another
+    // instance still maps it) they stay where they are and are read below.
+    if (hasVectorFile && pendingFile.existsAsFile())
+    {
+        juce::MemoryBlock pending;
+        pendingFile.loadFileAsData(pending);
+
+        const size_t wholeVectors = pending.getSize() / dimensions * dimensions;
+        bool merged = wholeVectors == 0;
+
+        if (!merged)
+        {
+            juce::FileOutputStream stream(vectorFile);
+            merged = stream.openedOk() && stream.write(pending.getData(), wholeVectors);
+            stream.flush();
+            merged = merged && stream.getStatus().wasOk();
+        }
+
+        if (merged)
+            pendingFile.deleteFile();
+    }
+
+    int numVectors = 0;
+
+    if (hasVectorFile)
+    {
+        mappedVectors = std::make_unique<juce::MemoryMappedFile>(vectorFile, juce::MemoryMappedFile::readOnly);
+
+        const auto* data = static_cast<const char*>(mappedVectors->getData());
+        const size_t mappedSize = mappedVectors->getSize();
+
+        const bool valid = data != nullptr && mappedSize >= (size_t)headerSize
+                        && std::memcmp(data, fileMagic, 4) == 0
+                        && juce::ByteOrder::littleEndianInt(data + 4) == fileVersion
+                        && juce::ByteOrder::littleEndianInt(data + 8) == (juce::uint32)dimensions;
+
+        if (valid)
+        {
+            numVectors = (int)((mappedSize - (size_t)headerSize) / dimensions);
+
+            if (pendingFile.existsAsFile())
+            {
+                juce::MemoryBlock pending;
+                pendingFile.loadFileAsData(pending);
+
+                const auto* pendingData = static_cast<const juce::int8*>(pending.getData());
+                const size_t pendingSize = pending.getSize() / dimensions * dimensions;
+
+                addedVectors.assign(pendingData, pendingData + pendingSize);
+            }
+        }
+        else
+        {
+            DBG("Discarding unreadable prompt index: " + vectorFile.getFullPathName());
+            mappedVectors.reset();
+            lines.clear();
+        }
+    }
+
+    numMappedVectors = numVectors;
+
+    // Line i and vector i must describe the same entry. Appends are
+    // serialised and write the line first, so the counts only differ after
+    // a crash (one extra line) or an interrupted merge (extra vectors past
+    // the last line); the shorter side decides and the files are rewritten.
+    const int numStoredVectors = numVectors + (int)(addedVectors.size() / dimensions);
+    const int numEntries = juce::jmin(numStoredVectors, lines.size());
+
+    if (numStoredVectors != lines.size())
+        DBG("Prompt index has " + juce::String(lines.size()) + " entries but " + juce::String(numStoredVectors)
+            + " vectors, keeping " + juce::String(numEntries) + ": " + directory.getFullPathName());
+
+    for (int i = 0; i < numEntries; ++i)
+    {
+        const auto& line = lines[i];
+        prompts.add(line.fromFirstOccurrenceOf("\t", false, false));
+        sampleFiles.add(line.upToFirstOccurrenceOf("\t", false, false));
+        knownPrompts.insert(prompts[i]);
+    }
+
+    if (!hasVectorFile || numEntries != numStoredVectors || numEntries != lines.size())
+    {
+        // Start fresh files, or rewrite them at the common length so
+        // appends line up again
+        juce::MemoryOutputStream vectors;
+        vectors.write(fileMagic, 4);
+        vectors.writeInt((int)fileVersion);
+        vectors.writeInt(dimensions);
+        vectors.writeInt(0);
+
+        std::vector<juce::int8> surviving;
+
+        for (int i = 0; i < numEntries; ++i)
+            surviving.insert(surviving.end(), getVector(i), getVector(i) + dimensions);
+
+        vectors.write(surviving.data(), surviving.size());
+
+        juce::StringArray entries;
+        for (int i = 0; i < numEntries; ++i)
+            entries.add(sampleFiles[i] + "\t" + prompts[i]);
+
+        // Keep the surviving vectors in memory; the old mapping is replaced
+        addedVectors = std::move(surviving);
+        mappedVectors.reset();
+        numMappedVectors = 0;
+
+        vectorFile.replaceWithData(vectors.getData(), vectors.getDataSize());
+        pendingFile.deleteFile();
+        entryFile.replaceWithText(numEntries > 0 ? entries.joinIntoString("\n") + "\n" : juce::String());
+    }
+
+    checkWritable();
+}
+
+void PromptIndex::checkWritable()
+{
+    // Opening for append leaves existing contents untouched
+    juce::FileOutputStream entryStream(directory.getChildFile("prompts.tsv"));
+    juce::FileOutputStream vectorStream(directory.getChildFile("prompts.pending.vec"));
+
+    readOnly = entryStream.failedToOpen() || vectorStream.failedToOpen();
+
+    if (readOnly)
+        DBG("Prompt index is read-only: " + directory.getFullPathName());
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Nearest-neighbour index over the prompts of past generations, so a
+// near-duplicate prompt ("deep bass synth" vs "deep synth bass") can be
+// answered from disk while the real generation runs.
+//
+// Prompts are embedded as signed hashed bags of words and character
+// trigrams, L2-normalised and quantised to int8. Lookup is a linear scan of
+// dot products over one contiguous array: 64 bytes per entry, so 100k
+// entries is 6.4 MB and scans in well under a millisecond.
+//
+// On disk the directory holds:
+//   prompts.vec          16-byte header, then one int8 vector per entry;
+//                        mapped read-only at open
+//   prompts.pending.vec  vectors added since, merged into prompts.vec at
+//                        the next open, so the mapped file is never written
+//   prompts.tsv          one "sample path <tab> prompt" line per entry
+// All are append-only. Several plugin instances, possibly in different
+// processes, share the directory: every append and the merge at open hold
+// an InterProcessLock, and appends reopen the files each time, so a line
+// and its vector always land at the same position.
+class PromptIndex
+{
+public:
+    static constexpr int dimensions = 64;
+    using Vector = std::array<juce::int8, dimensions>;
+
+    struct Match
+    {
+        bool found = false;
+        float similarity = 0.0f;    // cosine, -1..1
+        juce::String prompt;
+        juce::File sampleFile;
+    };
+
+    explicit PromptIndex(const juce::File& directory);
+    ~PromptIndex();
+
+    // Records a prompt and the sample generated for it. An identical prompt
+    // already in the index keeps its entry (callers overwrite the sample).
+    void add(const juce::String& prompt, const juce::File& sampleFile);
+
+    // Most similar stored prompt, if any reaches minSimilarity
+    Match findNearest(const juce::String& prompt, float minSimilarity = 0.0f) const;
+
+    int size() const;
+    const juce::File& getDirectory() const { return directory; }
+
+    static Vector embed(const juce::String& prompt);
+    static juce::String normalisePrompt(const juce::String& prompt);
+
+private:
+    juce::File directory;
+
+    mutable juce::CriticalSection lock;
+    juce::InterProcessLock fileLock;
+    bool readOnly = false;
+
+    // Entries in prompts.vec at open time are scanned straight from the
+    // mapping, the rest from memory
+    std::unique_ptr<juce::MemoryMappedFile> mappedVectors;
+    int numMappedVectors = 0;
+    std::vector<juce::int8> addedVectors;
+
+    juce::StringArray prompts;          // normalised
+    juce::StringArray sampleFiles;
+    std::set<juce::String> knownPrompts;
+
+    static constexpr int headerSize = 16;
+    static constexpr juce::uint32 fileVersion = 1;
+
+    void load();
+    void checkWritable();
+    bool append(const juce::String& entry, const Vector& vector);
+    const juce::int8* getVector(int index) const;
+};
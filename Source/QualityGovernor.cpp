@@ -0,0 +1,137 @@
+#include "QualityGovernor.h"
+
+namespace
+{
+    // The load follows a rise at once but decays over ~20 blocks, so one
+    // quick block does not hide a heavy passage
+    constexpr float loadDecay = 0.05f;
+}
+
+//==============================================================================
+QualityGovernor::QualityGovernor()
+{
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    level.store(Level::full);
+    smoothedLoad.store(0.0f);
+    numOverruns.store(0);
+
+    blockCount = 0;
+    calmBlocks = 0;
+    blocksSinceChange = 0;
+}
+
+QualityGovernor::Level QualityGovernor::update(double renderSeconds, double deadlineSeconds)
+{
+    if (deadlineSeconds <= 0.0)
+        return level.load();
+
+    ++blockCount;
+    ++blocksSinceChange;
+
+    const float load = (float)(renderSeconds / deadlineSeconds);
+
+    if (load > 1.0f)
+        numOverruns.fetch_add(1);
+
+    float smoothed = smoothedLoad.load();
+    smoothed = load > smoothed ? load : smoothed + (load - smoothed) * loadDecay;
+    smoothedLoad.store(smoothed);
+
+    const auto current = level.load();
+    const int index = (int)current;
+
+    // An overrun steps down straight away; otherwise give the previous
+    // step a few blocks to show its effect first
+    const bool overloaded = load > 1.0f
+                         || (smoothed > settings.downgradeLoad && blocksSinceChange >= settings.settleBlocks);
+
+    if (overloaded)
+    {
+        calmBlocks = 0;
+
+        if (index + 1 < numLevels)
+            changeLevel((Level)(index + 1));
+    }
+    else if (smoothed < settings.upgradeLoad && index > 0)
+    {
+        if (++calmBlocks >= settings.upgradeBlocks)
+        {
+            calmBlocks = 0;
+            changeLevel((Level)(index - 1));
+        }
+    }
+    else
+    {
+        calmBlocks = 0;
+    }
+
+    return level.load();
+}
+
+void QualityGovernor::apply(AISamplerEngine& engine) const
+{
+    const auto current = level.load();
+
+    engine.setInterpolationCeiling(current >= Level::dropSample ? InterpolationMode::DropSample
+                                 : current >= Level::linear     ? InterpolationMode::Linear
+                                                                : InterpolationMode::Hermite);
+
+    engine.setVoiceLimit(current >= Level::cappedPolyphony ? settings.cappedVoices : engine.getNumVoices());
+
+    if (current >= Level::shedReleases)
+        engine.fadeOutQuietestReleasedVoices(settings.voicesShedPerBlock, settings.shedFadeSeconds);
+}
+
+void QualityGovernor::changeLevel(Level newLevel)
+{
+    Event event;
+    event.from = level.load();
+    event.to = newLevel;
+    event.load = smoothedLoad.load();
+    event.block = blockCount;
+
+    level.store(newLevel);
+    blocksSinceChange = 0;
+
+    // A reader that falls behind loses events, never the audio thread's time
+    int start1, size1, start2, size2;
+    eventFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        events[(size_t)start1] = event;
+
+    eventFifo.finishedWrite(size1);
+}
+
+int QualityGovernor::readEvents(Event* destination, int maxEvents)
+{
+    int start1, size1, start2, size2;
+    eventFifo.prepareToRead(maxEvents, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        destination[i] = events[(size_t)(start1 + i)];
+
+    for (int i = 0; i < size2; ++i)
+        destination[size1 + i] = events[(size_t)(start2 + i)];
+
+    eventFifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+const char* QualityGovernor::getLevelName(Level level)
+{
+    switch (level)
+    {
+        case Level::full:               return "full";
+        case Level::linear:             return "linear";
+        case Level::dropSample:         return "drop-sample";
+        case Level::cappedPolyphony:    return "capped polyphony";
+        case Level::shedReleases:       return "shed releases";
+    }
+
+    return "";
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerEngine.h"
+
+//==============================================================================
+// Sheds render work when blocks get close to their deadline, and gives it
+// back once there is headroom again.
+//
+// Each block's render time is divided by the block's duration to get a
+// load. Above downgradeLoad the governor steps one level down the ladder;
+// only after upgradeBlocks consecutive blocks below upgradeLoad does it
+// step back up, so it does not oscillate around a threshold. Levels are
+// cumulative:
+//
+//   full               the engine's own settings
+//   linear             Hermite voices drop to linear interpolation
+//   dropSample         no interpolation
+//   cappedPolyphony    new notes steal once cappedVoices are sounding
+//   shedReleases       the quietest released voices are faded out
+//
+// update() and apply() run on the audio thread and never allocate or lock:
+// apply() only leaves requests in the engine's atomics, which its next
+// render carries out under the voice lock it already holds. Level changes
+// are posted to a lock-free FIFO for the UI or a log to read.
+class QualityGovernor
+{
+public:
+    enum class Level { full, linear, dropSample, cappedPolyphony, shedReleases };
+    static constexpr int numLevels = 5;
+
+    struct Settings
+    {
+        float downgradeLoad = 0.75f;
+        float upgradeLoad = 0.45f;
+        int upgradeBlocks = 100;        // calm blocks needed per step up
+        int settleBlocks = 8;           // blocks a downgrade gets to take effect
+        int cappedVoices = 8;
+        int voicesShedPerBlock = 2;
+        double shedFadeSeconds = 0.01;
+    };
+
+    struct Event
+    {
+        Level from = Level::full;
+        Level to = Level::full;
+        float load = 0.0f;              // smoothed load that triggered it
+        juce::int64 block = 0;
+    };
+
+    QualityGovernor();
+
+    void setSettings(const Settings& newSettings) { settings = newSettings; }
+    const Settings& getSettings() const { return settings; }
+
+    // Back to full quality, e.g. from prepareToPlay
+    void reset();
+
+    // Feeds one block's render time and returns the level for the next one.
+    // Blocks over their deadline are counted as overruns.
+    Level update(double renderSeconds, double deadlineSeconds);
+
+    // Applies the current level to an engine; call between blocks
+    void apply(AISamplerEngine& engine) const;
+
+    Level getLevel() const { return level.load(); }
+    float getLoad() const { return smoothedLoad.load(); }
+    juce::int64 getNumOverruns() const { return numOverruns.load(); }
+
+    // Drains level changes posted since the last call; returns how many
+    // were copied. Safe from any one thread other than the audio thread.
+    int readEvents(Event* destination, int maxEvents);
+
+    static const char* getLevelName(Level level);
+
+private:
+    Settings settings;
+
+    std::atomic<Level> level { Level::full };
+    std::atomic<float> smoothedLoad { 0.0f };
+    std::atomic<juce::int64> numOverruns { 0 };
+
+    juce::int64 blockCount = 0;
+    int calmBlocks = 0;
+    int blocksSinceChange = 0;
+
+    static constexpr int eventCapacity = 64;
+    juce::AbstractFifo eventFifo { eventCapacity };
+    std::array<Event, eventCapacity> events;
+
+    void changeLevel(Level newLevel);
+};
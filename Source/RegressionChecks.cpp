@@ -0,0 +1,651 @@
+#include "RegressionChecks.h"
+#include "SamplerEngine.h"
+#include "OfflineRenderer.h"
+#include "PitchDetector.h"
+#include "QualityGovernor.h"
+#include "SyntheticSignals.h"
+
+namespace
+{
+    constexpr double checkSampleRate = 48000.0;
+
+    // Allowed difference from a golden render or between block sizes
+    // (-80 dB); covers compiler and SIMD differences
+    constexpr float renderTolerance = 1.0e-4f;
+
+    // Golden renders are float WAVs: the scenes peak above full scale,
+    // which integer samples would clip
+    constexpr int goldenBitsPerSample = 32;
+
+    void print(const juce::String& line)
+    {
+        std::cout << line << std::endl;
+    }
+
+    // One fixed rendering setup; the tone and the MIDI are the same for all
+    struct Scene
+    {
+        const char* name;
+        InterpolationMode interpolation;
+        PlaybackMode playback;
+        bool compact;
+        bool expression;        // MPE bends and pressure
+        bool filtered;          // per-voice filter with its envelope
+    };
+
+    const Scene scenes[] =
+    {
+        { "linear",     InterpolationMode::Linear,     PlaybackMode::resample,    false, false, false },
+        { "hermite",    InterpolationMode::Hermite,    PlaybackMode::resample,    false, false, false },
+        { "dropsample", InterpolationMode::DropSample, PlaybackMode::resample,    false, false, false },
+        { "compact",    InterpolationMode::Hermite,    PlaybackMode::resample,    true,  false, false },
+        { "stretch",    InterpolationMode::Linear,     PlaybackMode::timeStretch, false, false, false },
+        { "expression", InterpolationMode::Linear,     PlaybackMode::resample,    false, true,  false },
+        { "filter",     InterpolationMode::Linear,     PlaybackMode::resample,    false, false, true  }
+    };
+
+    constexpr double sceneSeconds = 1.5;
+
+    struct ScheduledEvent
+    {
+        int sample;
+        juce::MidiMessage message;
+    };
+
+    AISamplerSound::Ptr makeSceneSound(const Scene& scene)
+    {
+        auto tone = SyntheticSignals::makeTone(220.0f, 2.0, checkSampleRate);
+        auto sound = AISamplerEngine::createAnalysedSound(tone, checkSampleRate);
+
+        if (sound != nullptr && scene.compact)
+            sound->makeCompact();
+
+        return sound;
+    }
+
+    // Events sit on a 64-sample grid, so every block size sees each one at
+    // the same sample
+    std::vector<ScheduledEvent> makeSceneEvents(const Scene& scene)
+    {
+        auto at = [](double seconds) { return (int)(seconds * checkSampleRate) / 64 * 64; };
+
+        std::vector<ScheduledEvent> events;
+        const int notes[] = { 48, 55, 60, 67 };
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const int channel = scene.expression ? 2 + i : 1;
+            events.push_back({ at(0.1 * i), juce::MidiMessage::noteOn(channel, notes[i], 0.5f + 0.1f * (float)i) });
+            events.push_back({ at(1.0 + 0.05 * i), juce::MidiMessage::noteOff(channel, notes[i]) });
+        }
+
+        if (scene.expression)
+        {
+            for (int step = 0; step < 20; ++step)
+            {
+                const double t = 0.3 + 0.03 * step;
+                events.push_back({ at(t), juce::MidiMessage::pitchWheel(2, 8192 + step * 200) });
+                events.push_back({ at(t), juce::MidiMessage::channelPressureChange(3, step * 6) });
+            }
+
+            // A master channel bend moves every note
+            events.push_back({ at(0.6), juce::MidiMessage::pitchWheel(1, 12000) });
+        }
+
+        std::stable_sort(events.begin(), events.end(),
+                         [](const ScheduledEvent& a, const ScheduledEvent& b) { return a.sample < b.sample; });
+        return events;
+    }
+
+    juce::AudioBuffer<float> renderScene(const Scene& scene, AISamplerSound::Ptr sound, int blockSize)
+    {
+        const int numSamples = (int)(sceneSeconds * checkSampleRate);
+
+        AISamplerEngine engine(16);
+        engine.setCurrentPlaybackSampleRate(checkSampleRate);
+        engine.setInterpolationMode(scene.interpolation);
+        engine.setPlaybackMode(scene.playback);
+        engine.setMPEEnabled(scene.expression);
+
+        if (scene.filtered)
+        {
+            VoiceFilterSettings filter;
+            filter.enabled = true;
+            filter.resonance = 0.6f;
+            engine.setFilterSettings(filter);
+        }
+
+        engine.loadPreparedSounds({ sound }, scene.name);
+
+        const auto events = makeSceneEvents(scene);
+
+        juce::AudioBuffer<float> output(2, numSamples);
+        juce::AudioBuffer<float> block(2, blockSize);
+        juce::MidiBuffer midi;
+        size_t nextEvent = 0;
+
+        for (int position = 0; position < numSamples; position += blockSize)
+        {
+            const int length = juce::jmin(blockSize, numSamples - position);
+
+            midi.clear();
+
+            for (; nextEvent < events.size() && events[nextEvent].sample < position + length; ++nextEvent)
+                midi.addEvent(events[nextEvent].message, events[nextEvent].sample - position);
+
+            block.clear();
+            engine.renderNextBlock(block, midi, 0, length);
+
+            for (int channel = 0; channel < output.getNumChannels(); ++channel)
+                output.copyFrom(channel, position, block, channel, 0, length);
+        }
+
+        return output;
+    }
+
+    // Largest sample difference on the first channel; lengths must match
+    float maxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        if (a.getNumSamples() != b.getNumSamples())
+            return std::numeric_limits<float>::max();
+
+        float worst = 0.0f;
+
+        for (int i = 0; i < a.getNumSamples(); ++i)
+            worst = juce::jmax(worst, std::abs(a.getSample(0, i) - b.getSample(0, i)));
+
+        return worst;
+    }
+
+    double timeBestOf(int runs, const std::function<void()>& work)
+    {
+        double best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < runs; ++i)
+        {
+            const double start = juce::Time::getMillisecondCounterHiRes();
+            work();
+            best = juce::jmin(best, juce::Time::getMillisecondCounterHiRes() - start);
+        }
+
+        return best;
+    }
+
+    //==========================================================================
+    // Governor stress: one more note every 100 ms, each held for 6 s, so the
+    // load ramps up to a plateau of 60 Hermite voices and back down. Large
+    // blocks keep the simulated deadline well above scheduler jitter.
+    constexpr int stressBlockSize = 2048;
+    constexpr int stressVoices = 64;
+    constexpr int stressAttempts = 5;
+
+    std::vector<ScheduledEvent> makeStressEvents()
+    {
+        auto at = [](double seconds) { return (int)std::llround(seconds * checkSampleRate); };
+
+        std::vector<ScheduledEvent> events;
+
+        for (int i = 0; i < 150; ++i)
+        {
+            const int note = 36 + (i * 7) % 60;
+            events.push_back({ at(i * 0.1), juce::MidiMessage::noteOn(1, note, 0.8f) });
+            events.push_back({ at(i * 0.1 + 6.0), juce::MidiMessage::noteOff(1, note) });
+        }
+
+        std::stable_sort(events.begin(), events.end(),
+                         [](const ScheduledEvent& a, const ScheduledEvent& b) { return a.sample < b.sample; });
+        return events;
+    }
+
+    struct StressRun
+    {
+        std::vector<double> blockSeconds;
+        int downgrades = 0;
+        int upgrades = 0;
+        int firstDowngradeBlock = -1;
+        QualityGovernor::Level lowest = QualityGovernor::Level::full;
+
+        int countOverruns(double deadline, int fromBlock = 0) const
+        {
+            return (int)std::count_if(blockSeconds.begin() + juce::jmin(fromBlock, (int)blockSeconds.size()),
+                                      blockSeconds.end(), [deadline](double t) { return t > deadline; });
+        }
+
+        double getWorstLoad(double deadline) const
+        {
+            return *std::max_element(blockSeconds.begin(), blockSeconds.end()) / deadline;
+        }
+    };
+
+    // Renders the whole stress passage, timing every block; a governor,
+    // when given, is updated and applied after each one
+    StressRun renderStress(AISamplerSound::Ptr sound, const std::vector<ScheduledEvent>& events,
+                           QualityGovernor* governor, double deadline)
+    {
+        AISamplerEngine engine(stressVoices);
+        engine.setCurrentPlaybackSampleRate(checkSampleRate);
+        engine.setInterpolationMode(InterpolationMode::Hermite);
+        engine.loadPreparedSounds({ sound }, "Stress");
+
+        const int numBlocks = (events.back().sample + (int)checkSampleRate) / stressBlockSize;
+        StressRun run;
+        run.blockSeconds.reserve((size_t)numBlocks);
+
+        juce::AudioBuffer<float> block(2, stressBlockSize);
+        juce::MidiBuffer midi;
+        size_t nextEvent = 0;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            const int position = b * stressBlockSize;
+
+            midi.clear();
+
+            for (; nextEvent < events.size() && events[nextEvent].sample < position + stressBlockSize; ++nextEvent)
+                midi.addEvent(events[nextEvent].message, events[nextEvent].sample - position);
+
+            block.clear();
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            engine.renderNextBlock(block, midi, 0, stressBlockSize);
+            run.blockSeconds.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+
+            if (governor != nullptr)
+            {
+                governor->update(run.blockSeconds.back(), deadline);
+                governor->apply(engine);
+
+                QualityGovernor::Event changes[16];
+                const int numChanges = governor->readEvents(changes, 16);
+
+                for (int i = 0; i < numChanges; ++i)
+                {
+                    const bool down = changes[i].to > changes[i].from;
+
+                    if (down && run.firstDowngradeBlock < 0)
+                        run.firstDowngradeBlock = b;
+
+                    ++(down ? run.downgrades : run.upgrades);
+                    run.lowest = juce::jmax(run.lowest, changes[i].to);
+                }
+            }
+        }
+
+        return run;
+    }
+}
+
+//==============================================================================
+RegressionRunner::RegressionRunner(const Options& o)
+    : options(o)
+{
+}
+
+juce::StringArray RegressionRunner::getCheckNames()
+{
+    return { "pitch", "loop", "render", "governor", "perf" };
+}
+
+int RegressionRunner::run(const juce::StringArray& checks)
+{
+    const auto selected = checks.isEmpty() ? getCheckNames() : checks;
+
+    // Every analysis in the run reuses these threads
+    juce::SharedResourcePointer<AnalysisThreadPool> analysisPool;
+
+    for (auto& check : selected)
+    {
+        if (!getCheckNames().contains(check))
+        {
+            print("Unknown check: " + check + " (available: " + getCheckNames().joinIntoString(", ") + ")");
+            return 1;
+        }
+    }
+
+    if (options.dataDirectory.createDirectory().failed())
+    {
+        print("Could not create data directory: " + options.dataDirectory.getFullPathName());
+        return 1;
+    }
+
+    print("Data: " + options.dataDirectory.getFullPathName());
+
+    if (selected.contains("pitch"))
+        checkPitch();
+
+    if (selected.contains("loop"))
+        checkLoop();
+
+    if (selected.contains("render"))
+        checkRender();
+
+    if (selected.contains("governor"))
+        checkGovernor();
+
+    if (selected.contains("perf"))
+        checkPerf();
+
+    print("");
+    print(juce::String::formatted("%d passed, %d failed", numPassed, numFailed));
+    return numFailed == 0 ? 0 : 1;
+}
+
+//==============================================================================
+void RegressionRunner::checkPitch()
+{
+    print("");
+    print("== pitch: harmonic tones A1-A6, detector within 5 cents, root note exact ==");
+
+    PitchDetector detector;
+
+    for (int note : { 33, 40, 45, 52, 57, 60, 64, 69, 76, 81, 88, 93 })
+    {
+        const float frequency = (float)juce::MidiMessage::getMidiNoteInHertz(note);
+        auto tone = SyntheticSignals::makeTone(frequency, 1.0, checkSampleRate);
+
+        const float detected = detector.detectPitch(tone, checkSampleRate);
+        const float cents = detected > 0.0f ? 1200.0f * std::log2(detected / frequency) : 0.0f;
+
+        expect(detected > 0.0f && std::abs(cents) <= 5.0f,
+               juce::String::formatted("note %d (%.1f Hz): detected %.2f Hz, %+.2f cents",
+                                       note, frequency, detected, cents));
+
+        auto sound = AISamplerEngine::createAnalysedSound(tone, checkSampleRate);
+
+        expect(sound != nullptr && sound->getRootNote() == note,
+               juce::String::formatted("note %d: analysed root %d", note, sound != nullptr ? sound->getRootNote() : -1));
+    }
+
+    juce::AudioBuffer<float> silence(1, (int)checkSampleRate);
+    silence.clear();
+
+    expect(detector.detectPitch(silence, checkSampleRate) == 0.0f, "silence has no pitch");
+}
+
+void RegressionRunner::checkLoop()
+{
+    print("");
+    print("== loop: trim, normalize and loop seam of 2 s tones ==");
+
+    auto baselines = loadBaselines(getMetricsFile());
+
+    for (float frequency : { 55.0f, 110.0f, 220.0f, 440.0f })
+    {
+        auto tone = SyntheticSignals::makeTone(frequency, 2.0, checkSampleRate);
+        const int originalLength = tone.getNumSamples();
+
+        auto sound = AISamplerEngine::createAnalysedSound(tone, checkSampleRate);
+
+        if (sound == nullptr)
+        {
+            expect(false, juce::String::formatted("%.0f Hz: analysed", frequency));
+            continue;
+        }
+
+        const int length = sound->getLength();
+        const float* data = sound->getAudioData().getReadPointer(0);
+        const auto range = juce::FloatVectorOperations::findMinAndMax(data, length);
+        const float peakDb = juce::Decibels::gainToDecibels(juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd())));
+
+        expect(length > 0 && length <= originalLength,
+               juce::String::formatted("%.0f Hz: trimmed to %d of %d samples", frequency, length, originalLength));
+        expect(std::abs(peakDb + 0.5f) <= 0.05f,
+               juce::String::formatted("%.0f Hz: normalized peak %.2f dB", frequency, peakDb));
+
+        const int loopStart = sound->getLoopStart();
+        const int loopEnd = sound->getLoopEnd();
+
+        if (loopStart < 1 || loopEnd <= loopStart + 2 || loopEnd > length)
+        {
+            expect(false, juce::String::formatted("%.0f Hz: loop %d-%d inside the sample", frequency, loopStart, loopEnd));
+            continue;
+        }
+
+        // Click at the seam: the jump from the loop end back to the loop
+        // start, against the typical step between neighbouring samples. The
+        // sample after the loop end is extrapolated when the loop runs to
+        // the end of the sample.
+        const float afterEnd = loopEnd < length ? data[loopEnd] : 2.0f * data[loopEnd - 1] - data[loopEnd - 2];
+        double stepSquares = 0.0;
+
+        for (int i = loopStart; i + 1 < loopEnd; ++i)
+            stepSquares += juce::square((double)data[i + 1] - data[i]);
+
+        const double rmsStep = std::sqrt(stepSquares / (loopEnd - loopStart - 1));
+        const double click = rmsStep > 0.0 ? std::abs(data[loopStart] - afterEnd) / rmsStep : 0.0;
+
+        compareWithBaseline(baselines, "loop.click." + juce::String((int)frequency) + "Hz", click, 0.1, 0.05, "steps",
+                            false);
+    }
+
+    if (options.updateBaselines)
+        saveBaselines(getMetricsFile(), baselines);
+}
+
+void RegressionRunner::checkRender()
+{
+    print("");
+    print(juce::String::formatted("== render: golden scenes at 48 kHz, tolerance %.0f dB ==",
+                                  juce::Decibels::gainToDecibels(renderTolerance)));
+
+    for (auto& scene : scenes)
+    {
+        auto sound = makeSceneSound(scene);
+
+        if (sound == nullptr)
+        {
+            expect(false, juce::String(scene.name) + ": sound analysed");
+            continue;
+        }
+
+        const auto rendered = renderScene(scene, sound, 256);
+        const auto goldenFile = options.dataDirectory.getChildFile("render-" + juce::String(scene.name) + ".wav");
+
+        juce::AudioBuffer<float> golden;
+        double goldenRate = 0.0;
+
+        if (options.updateBaselines)
+        {
+            auto writer = OfflineRenderer::createWavWriter(goldenFile, checkSampleRate, 1, goldenBitsPerSample);
+
+            expect(writer != nullptr && writer->writeFromAudioSampleBuffer(rendered, 0, rendered.getNumSamples()),
+                   juce::String(scene.name) + ": golden render written");
+        }
+        else if (!AISamplerEngine::readMonoFile(goldenFile, golden, goldenRate))
+        {
+            expect(false, juce::String(scene.name) + ": golden render " + goldenFile.getFileName()
+                              + " missing (write it with --update)");
+        }
+        else
+        {
+            const float difference = maxDifference(rendered, golden);
+
+            expect(goldenRate == checkSampleRate && difference <= renderTolerance,
+                   juce::String::formatted("%s: matches golden render (max difference %.1f dB)",
+                                           scene.name, juce::Decibels::gainToDecibels(difference, -200.0f)));
+        }
+
+        // Splitting blocks differently must not change the output
+        const float blockDifference = maxDifference(renderScene(scene, sound, 32), renderScene(scene, sound, 1024));
+
+        expect(blockDifference <= renderTolerance,
+               juce::String::formatted("%s: 32 and 1024 sample blocks agree (max difference %.1f dB)",
+                                       scene.name, juce::Decibels::gainToDecibels(blockDifference, -200.0f)));
+    }
+}
+
+void RegressionRunner::checkGovernor()
+{
+    print("");
+    print("== governor: notes pile up to 60 Hermite voices against a simulated deadline ==");
+
+    auto tone = SyntheticSignals::makeTone(110.0f, 8.0, checkSampleRate);
+    auto sound = AISamplerEngine::createAnalysedSound(tone, checkSampleRate);
+
+    if (sound == nullptr)
+    {
+        expect(false, "stress sound analysed");
+        return;
+    }
+
+    const auto events = makeStressEvents();
+
+    // Stand in for a machine too slow for the full load: the deadline is
+    // 60% of the 95th percentile of an ungoverned render's block times
+    auto calibration = renderStress(sound, events, nullptr, 0.0).blockSeconds;
+    std::sort(calibration.begin(), calibration.end());
+    const double deadline = 0.6 * calibration[calibration.size() * 95 / 100];
+
+    print(juce::String::formatted("  Simulated deadline: %.1f us per %d-sample block", deadline * 1.0e6, stressBlockSize));
+
+    const auto ungoverned = renderStress(sound, events, nullptr, deadline);
+
+    expect(ungoverned.countOverruns(deadline) > 0,
+           juce::String::formatted("ungoverned: %d of %d blocks over the deadline, worst load %.2f",
+                                   ungoverned.countOverruns(deadline), (int)ungoverned.blockSeconds.size(),
+                                   ungoverned.getWorstLoad(deadline)));
+
+    // The first downgrade gets one settle window to take effect; after
+    // that the governor must keep every block inside the deadline. A stall
+    // of the whole process can still push one block over, so like the
+    // timings it gets a few attempts.
+    for (int attempt = 1; attempt <= stressAttempts; ++attempt)
+    {
+        QualityGovernor governor;
+        const auto governed = renderStress(sound, events, &governor, deadline);
+
+        const int settledBlock = governed.firstDowngradeBlock < 0
+                               ? 0 : governed.firstDowngradeBlock + governor.getSettings().settleBlocks;
+        const int overruns = governed.countOverruns(deadline, settledBlock);
+        const bool last = overruns == 0 || attempt == stressAttempts;
+
+        const auto description = juce::String::formatted(
+            "governed (attempt %d): %d blocks over the deadline after block %d (%d before), worst load %.2f, "
+            "%d down, %d up, lowest level: %s",
+            attempt, overruns, settledBlock, governed.countOverruns(deadline) - overruns,
+            governed.getWorstLoad(deadline), governed.downgrades, governed.upgrades,
+            QualityGovernor::getLevelName(governed.lowest));
+
+        if (last)
+        {
+            expect(overruns == 0, description);
+            break;
+        }
+
+        print("  RETRY " + description);
+    }
+}
+
+void RegressionRunner::checkPerf()
+{
+    print("");
+    print(juce::String::formatted("== perf: best of 7 against this machine's timings, +%.0f%% allowed ==",
+                                  options.slowdownTolerance * 100.0));
+
+    auto baselines = loadBaselines(getTimingsFile());
+
+    // Absolute slack keeps timer jitter on short workloads from failing
+    constexpr double slackMs = 0.05;
+
+    const auto tone = SyntheticSignals::makeTone(110.0f, 3.0, checkSampleRate);
+
+    const double analysisMs = timeBestOf(7, [&tone]
+    {
+        auto copy = tone;
+        AISamplerEngine::createAnalysedSound(copy, checkSampleRate);
+    });
+
+    compareWithBaseline(baselines, "analysis.3s", analysisMs, options.slowdownTolerance, slackMs, "ms", true);
+
+    const double pitchMs = timeBestOf(7, [&tone]
+    {
+        PitchDetector().detectPitch(tone, checkSampleRate);
+    });
+
+    compareWithBaseline(baselines, "pitch.detect", pitchMs, options.slowdownTolerance, slackMs, "ms", true);
+
+    for (auto& scene : scenes)
+    {
+        auto sound = makeSceneSound(scene);
+
+        if (sound == nullptr)
+            continue;
+
+        const double renderMs = timeBestOf(7, [&scene, &sound] { renderScene(scene, sound, 256); });
+
+        compareWithBaseline(baselines, "render." + juce::String(scene.name), renderMs,
+                            options.slowdownTolerance, slackMs, "ms", true);
+    }
+
+    saveBaselines(getTimingsFile(), baselines);
+}
+
+//==============================================================================
+void RegressionRunner::expect(bool passed, const juce::String& description)
+{
+    print((passed ? "  PASS  " : "  FAIL  ") + description);
+
+    if (passed)
+        ++numPassed;
+    else
+        ++numFailed;
+}
+
+void RegressionRunner::compareWithBaseline(Baselines& baselines, const juce::String& name, double value,
+                                           double tolerance, double slack, const char* unit,
+                                           bool recordIfMissing)
+{
+    const auto existing = baselines.find(name);
+
+    if (options.updateBaselines || (existing == baselines.end() && recordIfMissing))
+    {
+        print(juce::String::formatted("  NEW   %s: %.4f %s", name.toRawUTF8(), value, unit));
+        baselines[name] = value;
+        return;
+    }
+
+    if (existing == baselines.end())
+    {
+        expect(false, juce::String::formatted("%s: %.4f %s, no baseline (write it with --update)",
+                                              name.toRawUTF8(), value, unit));
+        return;
+    }
+
+    const double limit = existing->second * (1.0 + tolerance) + slack;
+
+    expect(value <= limit, juce::String::formatted("%s: %.4f %s (baseline %.4f, limit %.4f)",
+                                                   name.toRawUTF8(), value, unit, existing->second, limit));
+}
+
+juce::File RegressionRunner::getMetricsFile() const
+{
+    return options.dataDirectory.getChildFile("metrics.tsv");
+}
+
+juce::File RegressionRunner::getTimingsFile() const
+{
+    return options.dataDirectory.getChildFile(
+        juce::File::createLegalFileName("timings-" + juce::SystemStats::getComputerName() + ".tsv"));
+}
+
+RegressionRunner::Baselines RegressionRunner::loadBaselines(const juce::File& file)
+{
+    Baselines baselines;
+
+    // One "name<TAB>value" line per baseline
+    for (auto& line : juce::StringArray::fromLines(file.loadFileAsString()))
+        if (line.containsChar('\t'))
+            baselines[line.upToFirstOccurrenceOf("\t", false, false)] = line.fromFirstOccurrenceOf("\t", false, false).getDoubleValue();
+
+    return baselines;
+}
+
+void RegressionRunner::saveBaselines(const juce::File& file, const Baselines& baselines)
+{
+    juce::String text;
+
+    for (auto& entry : baselines)
+        text << entry.first << "\t" << juce::String(entry.second, 6) << "\n";
+
+    file.replaceWithText(text);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Regression checks, run with `AIGenRender --check [check ...]`.
+//
+// Everything is driven by synthetic, deterministic input:
+//
+//   pitch    known-frequency tones through PitchDetector and the analysis
+//            pipeline; the root note must be exact
+//   loop     trim/normalize/loop results and the click at the loop seam
+//   render   fixed scenes rendered and compared with golden WAVs, plus
+//            block-size invariance
+//   governor a dense passage against a simulated deadline; once its first
+//            downgrade has settled, QualityGovernor must prevent every xrun
+//   perf     micro-benchmarks compared with stored timings
+//
+// Golden renders and baselines live in the data directory. The golden WAVs
+// and metrics.tsv are committed, so a missing one fails; --update writes
+// them all. Timings are machine specific, so they are kept per computer
+// name and recorded on the first run.
+// Returns a non-zero exit code when any check fails.
+class RegressionRunner
+{
+public:
+    struct Options
+    {
+        juce::File dataDirectory;
+        bool updateBaselines = false;
+        double slowdownTolerance = 0.25;    // fraction a timing may grow
+    };
+
+    explicit RegressionRunner(const Options& options);
+
+    int run(const juce::StringArray& checks);
+
+    static juce::StringArray getCheckNames();
+
+private:
+    Options options;
+    int numPassed = 0;
+    int numFailed = 0;
+
+    // name -> value, lower is better
+    using Baselines = std::map<juce::String, double>;
+
+    void checkPitch();
+    void checkLoop();
+    void checkRender();
+    void checkGovernor();
+    void checkPerf();
+
+    void expect(bool passed, const juce::String& description);
+
+    // Fails when value exceeds its baseline by more than the given fraction
+    // plus slack. Without a baseline it records value if recordIfMissing,
+    // and fails otherwise.
+    void compareWithBaseline(Baselines& baselines, const juce::String& name, double value,
+                             double tolerance, double slack, const char* unit, bool recordIfMissing);
+
+    juce::File getMetricsFile() const;
+    juce::File getTimingsFile() const;
+    static Baselines loadBaselines(const juce::File& file);
+    static void saveBaselines(const juce::File& file, const Baselines& baselines);
+};
@@ -0,0 +1,306 @@
+// AIGenRender - renders Standard MIDI Files through the sampler engine
+// without a DAW, for headless build machines.
+//
+//   AIGenRender --sample lead.wav --out stems/ song1.mid song2.mid
+//   AIGenRender --sample low.wav@36 --sample high.wav@72 --split-tracks song.mid
+//   AIGenRender --benchmark [suite ...]
+//   AIGenRender --check [--data dir] [--update] [check ...]
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "Benchmarks.h"
+#include "RegressionChecks.h"
+
+namespace
+{
+    struct RenderOptions
+    {
+        juce::StringArray samplePaths;
+        juce::Array<int> sampleNotes;     // -1 = detect the root note
+        juce::Array<juce::File> midiFiles;
+        juce::File outputDirectory = juce::File::getCurrentWorkingDirectory();
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numThreads = juce::SystemStats::getNumCpus();
+        double tailSeconds = 2.0;
+        bool splitTracks = false;
+        bool compactSamples = false;
+    };
+
+    struct RenderJob
+    {
+        juce::String name;
+        juce::MidiMessageSequence sequence;
+        juce::File outputFile;
+        RenderStats stats;
+        bool written = false;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: AIGenRender --sample <file.wav[@note]> [options] <file.mid> ...\n"
+                     "       AIGenRender --benchmark [" << BenchmarkRunner::getSuiteNames().joinIntoString("|") << " ...]\n"
+                     "       AIGenRender --check [--data <dir>] [--update] [--tolerance <fraction>] ["
+                                  << RegressionRunner::getCheckNames().joinIntoString("|") << " ...]\n"
+                     "\n"
+                     "Options:\n"
+                     "  --sample <wav[@note]>  Sample to play; repeat with @note for key zones\n"
+                     "  --out <dir>            Output directory (default: current directory)\n"
+                     "  --rate <hz>            Output sample rate (default: 48000)\n"
+                     "  --block <samples>      Render block size (default: 512)\n"
+                     "  --threads <n>          Parallel render jobs (default: all cores)\n"
+                     "  --tail <seconds>       Release tail after the last event (default: 2)\n"
+                     "  --split-tracks         Render each MIDI track to its own stem\n"
+                     "  --compact              Hold samples as 16-bit block-scaled data\n"
+                     "\n"
+                     "Check options:\n"
+                     "  --data <dir>           Golden renders and baselines (default: ./RegressionData)\n"
+                     "  --update               Rewrite golden renders and baselines instead of comparing\n"
+                     "  --tolerance <fraction> Slowdown allowed against stored timings (default: 0.25)\n";
+    }
+
+    bool parseCheckArguments(const juce::StringArray& args, RegressionRunner::Options& options,
+                             juce::StringArray& checks)
+    {
+        options.dataDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("RegressionData");
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+
+            if (arg == "--data" && hasValue)
+                options.dataDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--update")
+                options.updateBaselines = true;
+            else if (arg == "--tolerance" && hasValue)
+                options.slowdownTolerance = args[++i].getDoubleValue();
+            else if (arg.startsWith("--"))
+            {
+                std::cout << "Unknown or incomplete option: " << arg << "\n";
+                return false;
+            }
+            else
+                checks.add(arg);
+        }
+
+        return options.slowdownTolerance >= 0.0;
+    }
+
+    bool parseArguments(const juce::StringArray& args, RenderOptions& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+
+            if (arg == "--sample" && hasValue)
+            {
+                const auto value = args[++i];
+                const bool hasNote = value.containsChar('@');
+
+                options.samplePaths.add(hasNote ? value.upToLastOccurrenceOf("@", false, false) : value);
+                options.sampleNotes.add(hasNote ? value.fromLastOccurrenceOf("@", false, false).getIntValue() : -1);
+            }
+            else if (arg == "--out" && hasValue)
+                options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--rate" && hasValue)
+                options.sampleRate = args[++i].getDoubleValue();
+            else if (arg == "--block" && hasValue)
+                options.blockSize = args[++i].getIntValue();
+            else if (arg == "--threads" && hasValue)
+                options.numThreads = args[++i].getIntValue();
+            else if (arg == "--tail" && hasValue)
+                options.tailSeconds = args[++i].getDoubleValue();
+            else if (arg == "--split-tracks")
+                options.splitTracks = true;
+            else if (arg == "--compact")
+                options.compactSamples = true;
+            else if (arg.startsWith("--"))
+            {
+                std::cout << "Unknown or incomplete option: " << arg << "\n";
+                return false;
+            }
+            else
+                options.midiFiles.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+        }
+
+        return !options.samplePaths.isEmpty() && !options.midiFiles.isEmpty()
+            && options.sampleRate > 0.0 && options.blockSize > 0 && options.numThreads > 0;
+    }
+
+    // Analyses the samples once; the resulting sounds are shared by all jobs
+    std::vector<AISamplerSound::Ptr> loadInstrument(const RenderOptions& options)
+    {
+        auto sounds = AISamplerEngine::analyseFiles(options.samplePaths, options.sampleNotes);
+
+        for (int i = 0; i < (int)sounds.size(); ++i)
+            if (sounds[(size_t)i] == nullptr)
+                std::cout << "Could not read sample: " << options.samplePaths[i] << "\n";
+
+        if (options.samplePaths.size() > 1)
+        {
+            // Zones without an explicit note are placed at their detected root
+            juce::Array<int> zoneNotes;
+            for (int i = 0; i < (int)sounds.size(); ++i)
+                zoneNotes.add(options.sampleNotes[i] >= 0 || sounds[(size_t)i] == nullptr
+                                  ? options.sampleNotes[i] : sounds[(size_t)i]->getRootNote());
+
+            AISamplerEngine::mapKeyZones(sounds, zoneNotes);
+        }
+        else
+        {
+            sounds.erase(std::remove(sounds.begin(), sounds.end(), nullptr), sounds.end());
+        }
+
+        // Converted before any render job shares them
+        if (options.compactSamples)
+            for (auto& sound : sounds)
+                sound->makeCompact();
+
+        return sounds;
+    }
+
+    int render(const RenderOptions& options)
+    {
+        const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+        auto sounds = loadInstrument(options);
+
+        if (sounds.empty())
+            return 1;
+
+        std::cout << "Loaded " << (int)sounds.size() << " zone(s) in "
+                  << juce::String((juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0, 2) << " s\n";
+
+        // One job per file, or per track with --split-tracks
+        std::vector<RenderJob> jobs;
+
+        for (auto& midiFile : options.midiFiles)
+        {
+            std::vector<juce::MidiMessageSequence> sequences;
+
+            if (!OfflineRenderer::readMidiFile(midiFile, sequences, options.splitTracks))
+            {
+                std::cout << "Could not read MIDI file: " << midiFile.getFullPathName() << "\n";
+                return 1;
+            }
+
+            for (size_t t = 0; t < sequences.size(); ++t)
+            {
+                RenderJob job;
+                job.name = midiFile.getFileNameWithoutExtension();
+
+                if (options.splitTracks)
+                    job.name += "_track" + juce::String((int)t + 1);
+
+                job.sequence = sequences[t];
+                job.outputFile = options.outputDirectory.getChildFile(job.name + ".wav");
+                jobs.push_back(std::move(job));
+            }
+        }
+
+        if (jobs.empty())
+        {
+            std::cout << "Nothing to render\n";
+            return 1;
+        }
+
+        options.outputDirectory.createDirectory();
+
+        const OfflineRenderer renderer(sounds, options.sampleRate, options.blockSize);
+        const int numThreads = juce::jmin(options.numThreads, (int)jobs.size());
+        const double renderStart = juce::Time::getMillisecondCounterHiRes();
+
+        {
+            juce::ThreadPool pool(numThreads);
+            std::atomic<int> remaining { (int)jobs.size() };
+            juce::WaitableEvent allDone;
+
+            for (auto& job : jobs)
+            {
+                pool.addJob([&job, &renderer, &options, &remaining, &allDone]
+                {
+                    if (auto writer = OfflineRenderer::createWavWriter(job.outputFile, options.sampleRate))
+                    {
+                        job.stats = renderer.render(job.sequence, writer.get(), options.tailSeconds);
+                        job.written = true;
+                    }
+
+                    if (--remaining == 0)
+                        allDone.signal();
+                });
+            }
+
+            allDone.wait();
+        }
+
+        const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - renderStart) / 1000.0;
+        double totalAudioSeconds = 0.0;
+        int failures = 0;
+
+        for (auto& job : jobs)
+        {
+            if (!job.written)
+            {
+                std::cout << "  " << job.name << ": could not write " << job.outputFile.getFullPathName() << "\n";
+                ++failures;
+                continue;
+            }
+
+            totalAudioSeconds += job.stats.audioSeconds;
+
+            std::cout << "  " << job.name << ": "
+                      << juce::String(job.stats.audioSeconds, 1) << " s audio in "
+                      << juce::String(job.stats.renderSeconds, 2) << " s ("
+                      << juce::String(job.stats.getRealtimeFactor(), 1) << "x realtime)\n";
+        }
+
+        std::cout << "Rendered " << juce::String(totalAudioSeconds, 1) << " s of audio in "
+                  << juce::String(wallSeconds, 2) << " s on " << numThreads << " thread(s): "
+                  << juce::String(wallSeconds > 0.0 ? totalAudioSeconds / wallSeconds : 0.0, 1)
+                  << "x realtime\n";
+
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    if (args.contains("--benchmark"))
+    {
+        args.removeString("--benchmark");
+        return BenchmarkRunner().run(args);
+    }
+
+    if (args.contains("--check"))
+    {
+        args.removeString("--check");
+
+        RegressionRunner::Options checkOptions;
+        juce::StringArray checks;
+
+        if (!parseCheckArguments(args, checkOptions, checks))
+        {
+            printUsage();
+            return 1;
+        }
+
+        return RegressionRunner(checkOptions).run(checks);
+    }
+
+    RenderOptions options;
+
+    if (!parseArguments(args, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    return render(options);
+}
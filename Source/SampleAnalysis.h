@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Analysis results the backend sends with a generated clip. The clip it
+// describes is already trimmed and normalized.
+struct SampleAnalysis
+{
+    bool present = false;
+    int rootNote = 60;
+    int loopStart = 0;
+    int loopEnd = 0;
+    int length = 0;             // samples
+    double sampleRate = 0.0;
+    float peakDecibels = 0.0f;
+
+    // Reads the "analysis" object of a backend response; present stays
+    // false when a field is missing
+    static SampleAnalysis fromJSON(const juce::var& json)
+    {
+        SampleAnalysis analysis;
+
+        if (!json.isObject())
+            return analysis;
+
+        for (auto* field : { "root_note", "loop_start", "loop_end", "length", "sample_rate" })
+            if (!json.hasProperty(field))
+                return analysis;
+
+        analysis.rootNote = (int)json["root_note"];
+        analysis.loopStart = (int)json["loop_start"];
+        analysis.loopEnd = (int)json["loop_end"];
+        analysis.length = (int)json["length"];
+        analysis.sampleRate = (double)json["sample_rate"];
+        analysis.peakDecibels = (float)(double)json.getProperty("peak_db", 0.0);
+        analysis.present = true;
+
+        return analysis;
+    }
+
+    // True if this describes the decoded file exactly and can replace the
+    // engine's own analysis
+    bool isTrustedFor(int numSamples, double fileSampleRate) const
+    {
+        return present
+            && length == numSamples
+            && std::abs(sampleRate - fileSampleRate) < 0.5
+            && rootNote >= 0 && rootNote <= 127
+            && loopStart >= 0 && loopStart < loopEnd && loopEnd <= numSamples;
+    }
+};
@@ -1,5 +1,64 @@
 #include "SamplerEngine.h"
 #include "PitchDetector.h"
+#include "FastMath.h"
+
+namespace
+{
+    float pitchWheelToSemitones(int wheelValue, float range)
+    {
+        return (float)(wheelValue - 8192) / 8192.0f * range;
+    }
+    
+    // Full pressure adds up to +3.5 dB; no pressure leaves the note as played
+    float pressureToGain(float pressure)
+    {
+        return 1.0f + 0.5f * pressure;
+    }
+    
+    // A unit of analysis work that runs exactly once: on a pool thread, or
+    // inline on the thread that waits for it if no worker has picked it up
+    // yet. Waiters help instead of blocking, so tasks can wait on tasks
+    // without starving the pool.
+    class AnalysisTask
+    {
+    public:
+        using Ptr = std::shared_ptr<AnalysisTask>;
+        
+        static Ptr launch(AnalysisThreadPool& pool, std::function<void()> work)
+        {
+            auto task = std::make_shared<AnalysisTask>(std::move(work));
+            pool.addJob([task] { task->runIfPending(); });
+            return task;
+        }
+        
+        explicit AnalysisTask(std::function<void()> w) : work(std::move(w)) {}
+        
+        void runIfPending()
+        {
+            int expected = pending;
+            
+            if (state.compare_exchange_strong(expected, running))
+            {
+                work();
+                state.store(finished);
+                done.signal();
+            }
+        }
+        
+        void waitOrRun()
+        {
+            runIfPending();
+            done.wait();
+        }
+        
+    private:
+        enum { pending, running, finished };
+        
+        std::atomic<int> state { pending };
+        juce::WaitableEvent done { true };
+        std::function<void()> work;
+    };
+}
 
 //==============================================================================
 // AISamplerSound Implementation
@@ -11,7 +70,27 @@ AISamplerSound::AISamplerSound(const juce::String& name,
     : rootNote(rootMidiNote), sourceSampleRate(sampleRate)
 {
     audioData.makeCopyOf(source);
-    loopEnd = audioData.getNumSamples();
+    length = audioData.getNumSamples();
+    loopEnd = length;
+    
+    const double rootFrequency = juce::MidiMessage::getMidiNoteInHertz(rootNote);
+    timeStretch = TimeStretchAnalysis::analyse(audioData.getReadPointer(0), length, sampleRate / rootFrequency);
+    peaks = WaveformPeaks::build(audioData.getReadPointer(0), length);
+}
+
+void AISamplerSound::makeCompact()
+{
+    if (compact)
+        return;
+    
+    compactData = CompactSampleBuffer(audioData.getReadPointer(0), length);
+    audioData.setSize(0, 0);
+    compact = true;
+}
+
+size_t AISamplerSound::getSizeInBytes() const
+{
+    return (compact ? compactData.getSizeInBytes() : (size_t)length * sizeof(float)) + peaks.getSizeInBytes();
 }
 
 //==============================================================================
@@ -24,7 +103,9 @@ AISamplerVoice::AISamplerVoice()
     adsrParams.decay = 0.1f;
     adsrParams.sustain = 0.8f;
     adsrParams.release = 0.3f;
-    adsr.setParameters(adsrParams);
+    envelope.setParameters(adsrParams);
+    
+    filterEnvelope.setParameters(VoiceFilterSettings().envelope);
 }
 
 bool AISamplerVoice::canPlaySound(juce::SynthesiserSound* sound)
@@ -39,114 +120,979 @@ void AISamplerVoice::startNote(int midiNoteNumber, float velocity,
     if (auto* samplerSound = dynamic_cast<AISamplerSound*>(sound))
     {
         currentVelocity = velocity;
-        sourceSamplePosition = 0.0;
+        phase = 0;
+        fadingOut = false;
+        
+        // Expression in effect when the note starts applies at once
+        noteBendSemitones = pitchWheelToSemitones(currentPitchWheelPosition, pitchBendRange);
+        bendGlide.reset(noteBendSemitones + masterBendSemitones);
+        pressureGlide.reset(1.0f);
+        timbre = 0.5f;
         
         updatePitchRatio(midiNoteNumber, samplerSound);
         
-        adsr.setSampleRate(samplerSound->getSourceSampleRate());
-        adsr.noteOn();
+        envelope.setSampleRate(getSampleRate() > 0.0 ? getSampleRate() : samplerSound->getSourceSampleRate());
+        envelope.noteOn();
+        
+        filterEnvelope.setSampleRate(getSampleRate() > 0.0 ? getSampleRate() : samplerSound->getSourceSampleRate());
+        filterEnvelope.reset();
+        filterEnvelope.noteOn();
+        filterNeedsReset = true;
+        
+        const auto& analysis = samplerSound->getTimeStretchAnalysis();
+        notePlaybackMode = analysis.isValid() ? playbackMode : PlaybackMode::resample;
+        
+        if (notePlaybackMode == PlaybackMode::timeStretch)
+        {
+            // The first two grains read the same samples, one fading out
+            // from its peak while the other fades in, so the attack plays
+            // unwindowed
+            grains[0] = { 0, analysis.hop, true };
+            grains[1] = { 0, 0, true };
+            samplesUntilNextGrain = analysis.hop;
+            
+            const double outputRate = getSampleRate() > 0.0 ? getSampleRate() : samplerSound->getSourceSampleRate();
+            readHead = 0;
+            readHeadIncrement = VoiceRenderer::toPhaseIncrement(stretchSpeed * samplerSound->getSourceSampleRate() / outputRate);
+        }
     }
 }
 
+void AISamplerVoice::setPlaybackMode(PlaybackMode newMode, double timeStretchSpeed)
+{
+    playbackMode = newMode;
+    stretchSpeed = juce::jlimit(0.125, 8.0, timeStretchSpeed);
+}
+
 void AISamplerVoice::stopNote(float velocity, bool allowTailOff)
 {
     if (allowTailOff)
     {
-        adsr.noteOff();
+        envelope.noteOff();
+        filterEnvelope.noteOff();
     }
     else
     {
         clearCurrentNote();
-        adsr.reset();
+        envelope.reset();
+        filterEnvelope.reset();
+        publishPlayPosition(nullptr);
     }
 }
 
+void AISamplerVoice::fadeOut(double seconds)
+{
+    fadingOut = true;
+    envelope.fadeOut(seconds);
+}
+
+void AISamplerVoice::pitchWheelMoved(int newPitchWheelValue)
+{
+    noteBendSemitones = pitchWheelToSemitones(newPitchWheelValue, pitchBendRange);
+    updateBendTarget();
+}
+
+void AISamplerVoice::controllerMoved(int controllerNumber, int newControllerValue)
+{
+    if (controllerNumber == 74)
+        timbre = (float)newControllerValue / 127.0f;
+}
+
+void AISamplerVoice::channelPressureChanged(int newChannelPressureValue)
+{
+    // A released note keeps the pressure it was let go with
+    if (isPlayingButReleased())
+        return;
+    
+    pressureGlide.setTarget(pressureToGain((float)newChannelPressureValue / 127.0f),
+                            glideSamples(pressureGlideSeconds));
+}
+
+void AISamplerVoice::aftertouchChanged(int newAftertouchValue)
+{
+    channelPressureChanged(newAftertouchValue);
+}
+
+void AISamplerVoice::setMasterBend(float semitones)
+{
+    masterBendSemitones = semitones;
+    
+    if (isVoiceActive())
+        updateBendTarget();
+}
+
+void AISamplerVoice::setInitialExpression(float pressure, float newTimbre)
+{
+    pressureGlide.reset(pressureToGain(pressure));
+    timbre = newTimbre;
+}
+
+void AISamplerVoice::setFilterEnvelopeParameters(const juce::ADSR::Parameters& newParameters)
+{
+    filterEnvelope.setParameters(newParameters);
+}
+
+float AISamplerVoice::getFilterCutoff(const VoiceFilterSettings& settings) const
+{
+    // Velocity closes the filter from the cutoff set for a full-velocity
+    // note; CC74 opens or closes it around its centre
+    const float semitones = settings.envelopeAmount * filterEnvelope.getLevel()
+                              + settings.keyTracking * (float)(getCurrentlyPlayingNote() - 60)
+                              - settings.velocityAmount * (1.0f - currentVelocity)
+                              + settings.timbreAmount * 2.0f * (timbre - 0.5f);
+    
+    return settings.cutoffHz * FastMath::semitonesToRatio(semitones);
+}
+
+void AISamplerVoice::advanceFilterEnvelope(int numSamples)
+{
+    // A stage at a time, as VoiceEnvelope::advance never crosses a stage end
+    while (numSamples > 0 && filterEnvelope.isActive()
+           && filterEnvelope.getStage() != VoiceEnvelope::Stage::sustain)
+    {
+        const int step = juce::jmin(numSamples, filterEnvelope.getSamplesUntilStageEnd());
+        filterEnvelope.advance(step);
+        numSamples -= step;
+    }
+}
+
+void AISamplerVoice::updateBendTarget()
+{
+    bendGlide.setTarget(noteBendSemitones + masterBendSemitones, glideSamples(bendGlideSeconds));
+}
+
+int AISamplerVoice::glideSamples(double seconds) const
+{
+    return juce::jmax(1, juce::roundToInt(seconds * (getSampleRate() > 0.0 ? getSampleRate() : 44100.0)));
+}
+
+juce::uint64 AISamplerVoice::getIncrementForBend(float semitones) const
+{
+    return VoiceRenderer::toPhaseIncrement(baseIncrementRatio * FastMath::semitonesToRatio(semitones));
+}
+
+float AISamplerVoice::getGainAfter(int numSamples) const
+{
+    return (envelope.getLevel() + envelope.getSlope() * (float)numSamples) * currentVelocity
+               * pressureGlide.peek(numSamples);
+}
+
 void AISamplerVoice::updatePitchRatio(int midiNote, AISamplerSound* sound)
 {
     // Calculate pitch ratio for resampling
     // Each semitone is 2^(1/12) frequency ratio
     int semitoneOffset = midiNote - sound->getRootNote();
     pitchRatio = std::pow(2.0, semitoneOffset / 12.0);
+    
+    // Step through the source at its own rate, whatever the output rate is
+    const double outputRate = getSampleRate() > 0.0 ? getSampleRate() : sound->getSourceSampleRate();
+    baseIncrementRatio = pitchRatio * sound->getSourceSampleRate() / outputRate;
+    phaseIncrement = getIncrementForBend(bendGlide.current);
 }
 
 void AISamplerVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer,
                                       int startSample, int numSamples)
 {
-    if (auto* samplerSound = dynamic_cast<AISamplerSound*>(getCurrentlyPlayingSound().get()))
+    auto* samplerSound = dynamic_cast<AISamplerSound*>(getCurrentlyPlayingSound().get());
+    
+    if (samplerSound == nullptr || outputBuffer.getNumChannels() == 0)
+        return;
+    
+    if (notePlaybackMode == PlaybackMode::timeStretch)
     {
-        const auto& sourceBuffer = samplerSound->getAudioData();
-        const int sourceLength = sourceBuffer.getNumSamples();
-        const int loopStart = samplerSound->getLoopStart();
-        const int loopEnd = samplerSound->getLoopEnd();
-        const bool looping = (loopEnd > loopStart) && (loopEnd <= sourceLength);
+        renderTimeStretched(outputBuffer, startSample, numSamples, *samplerSound);
+        publishPlayPosition(samplerSound);
+        return;
+    }
+    
+    const int sourceLength = samplerSound->getLength();
+    const int loopStart = samplerSound->getLoopStart();
+    const int loopEnd = samplerSound->getLoopEnd();
+    const bool looping = (loopEnd > loopStart) && (loopEnd <= sourceLength);
+    const juce::uint64 loopLength = (juce::uint64)(loopEnd - loopStart) << VoiceRenderer::phaseFractionBits;
+    
+    // Kernel taps must stay below this index
+    const juce::int64 boundary = looping ? loopEnd : sourceLength;
+    
+    const bool compact = samplerSound->isCompact();
+    
+    VoiceRenderer::Span span;
+    span.source = compact ? nullptr : samplerSound->getAudioData().getReadPointer(0);
+    span.outputs = outputBuffer.getArrayOfWritePointers();
+    span.numOutputChannels = outputBuffer.getNumChannels();
+    span.outputStart = startSample;
+    span.phase = phase;
+    span.increment = phaseIncrement;
+    
+    int remaining = numSamples;
+    
+    while (remaining > 0)
+    {
+        // Check if we're done playing
+        if (!envelope.isActive() || (!looping && VoiceRenderer::phaseIndex(span.phase) >= sourceLength))
+        {
+            clearCurrentNote();
+            envelope.reset();
+            break;
+        }
+        
+        // Handle looping
+        while (looping && VoiceRenderer::phaseIndex(span.phase) >= loopEnd)
+            span.phase -= loopLength;
+        
+        // The gain is linear within an envelope stage, so a span never
+        // crosses a stage change. While expression glides, spans are kept
+        // short and gain and increment ramp linearly between their ends.
+        int spanLength = juce::jmin(remaining, envelope.getSamplesUntilStageEnd());
+        
+        if (bendGlide.isGliding() || pressureGlide.isGliding())
+            spanLength = juce::jmin(spanLength, modulationSpanLength);
         
-        for (int i = 0; i < numSamples; ++i)
+        // A bend glide is monotonic within a span, so the larger end
+        // increment bounds every step
+        const juce::uint64 maxIncrement = bendGlide.isGliding()
+                                              ? juce::jmax(span.increment, getIncrementForBend(bendGlide.peek(spanLength)))
+                                              : span.increment;
+        
+        const juce::int64 index = VoiceRenderer::phaseIndex(span.phase);
+        const bool insideSource = index >= VoiceRenderer::tapsBefore && index + VoiceRenderer::tapsAfter < boundary;
+        juce::int64 first = 0;
+        
+        if (insideSource)
         {
-            // Check if we're done playing
-            if (!adsr.isActive() || (sourceSamplePosition >= sourceLength && !looping))
+            // Steps until the last tap would reach the boundary
+            const juce::uint64 headroom = ((juce::uint64)(boundary - VoiceRenderer::tapsAfter) << VoiceRenderer::phaseFractionBits)
+                                              - span.phase;
+            const juce::uint64 safeSteps = (headroom - 1) / maxIncrement + 1;
+            
+            spanLength = (int)juce::jmin((juce::uint64)spanLength, safeSteps);
+            
+            if (compact)
             {
-                clearCurrentNote();
-                break;
+                first = index - VoiceRenderer::tapsBefore;
+                const juce::uint64 firstPhase = (juce::uint64)first << VoiceRenderer::phaseFractionBits;
+                const juce::uint64 scratchHeadroom = ((juce::uint64)(decodeScratchSize - VoiceRenderer::tapsAfter) << VoiceRenderer::phaseFractionBits)
+                                                         - (span.phase - firstPhase);
+                
+                spanLength = (int)juce::jmin((juce::uint64)spanLength, (scratchHeadroom - 1) / maxIncrement + 1);
             }
+        }
+        else
+        {
+            spanLength = 1;
+        }
+        
+        // Ramps to the values at the end of the span; exp2 runs once per span
+        const juce::uint64 endIncrement = bendGlide.isGliding() ? getIncrementForBend(bendGlide.peek(spanLength))
+                                                                : span.increment;
+        
+        span.gain = envelope.getLevel() * currentVelocity * pressureGlide.current;
+        span.gainIncrement = (getGainAfter(spanLength) - span.gain) / (float)spanLength;
+        span.incrementDelta = ((juce::int64)endIncrement - (juce::int64)span.increment) / spanLength;
+        
+        if (insideSource)
+        {
+            const auto kernel = VoiceRenderer::getKernel(interpolationMode, span.numOutputChannels,
+                                                         span.gainIncrement != 0.0f || span.incrementDelta != 0);
             
-            // Handle looping
-            if (looping && sourceSamplePosition >= loopEnd)
+            if (compact)
             {
-                sourceSamplePosition = loopStart + (sourceSamplePosition - loopEnd);
+                // Decode only the source range this span reads, then run the
+                // float kernel over the scratch copy
+                const juce::uint64 firstPhase = (juce::uint64)first << VoiceRenderer::phaseFractionBits;
+                const juce::int64 last = VoiceRenderer::phaseIndex(span.phase + (juce::uint64)(spanLength - 1) * maxIncrement)
+                                             + VoiceRenderer::tapsAfter;
+                
+                samplerSound->getCompactData().decode((int)first, (int)(last - first + 1), decodeScratch.data());
+                
+                span.source = decodeScratch.data();
+                span.phase -= firstPhase;
+                kernel(span, spanLength);
+                span.phase += firstPhase;
             }
-            
-            // Linear interpolation for resampling
-            int index0 = (int)sourceSamplePosition;
-            int index1 = index0 + 1;
-            
-            if (index1 >= sourceLength)
+            else
             {
-                if (!looping)
-                    break;
-                index1 = loopStart;
+                kernel(span, spanLength);
             }
+        }
+        else
+        {
+            renderSampleAtBoundary(span, *samplerSound, looping);
+        }
+        
+        // The ramp's truncated step can fall short of the target; start the
+        // next span exactly on it
+        span.increment = endIncrement;
+        
+        bendGlide.advance(spanLength);
+        pressureGlide.advance(spanLength);
+        envelope.advance(spanLength);
+        remaining -= spanLength;
+    }
+    
+    phase = span.phase;
+    phaseIncrement = span.increment;
+    
+    publishPlayPosition(samplerSound);
+}
+
+void AISamplerVoice::publishPlayPosition(const AISamplerSound* sound)
+{
+    const juce::uint64 position = notePlaybackMode == PlaybackMode::timeStretch ? readHead : phase;
+    const bool sounding = sound != nullptr && isVoiceActive();
+    
+    playPositionSound.store(sounding ? sound : nullptr, std::memory_order_relaxed);
+    playPosition.store(sounding ? (int)VoiceRenderer::phaseIndex(position) : -1, std::memory_order_relaxed);
+}
+
+void AISamplerVoice::renderSampleAtBoundary(VoiceRenderer::Span& span, const AISamplerSound& sound, bool looping)
+{
+    const int sourceLength = sound.getLength();
+    const int loopStart = sound.getLoopStart();
+    const int loopEnd = sound.getLoopEnd();
+    const juce::int64 index = VoiceRenderer::phaseIndex(span.phase);
+    
+    // Taps past the loop end read from the loop start; anything else
+    // outside the source is silence
+    float taps[VoiceRenderer::numTaps];
+    
+    for (int t = 0; t < VoiceRenderer::numTaps; ++t)
+    {
+        juce::int64 tapIndex = index + t - VoiceRenderer::tapsBefore;
+        
+        if (looping && tapIndex >= loopEnd)
+            tapIndex -= loopEnd - loopStart;
+        
+        taps[t] = (tapIndex >= 0 && tapIndex < sourceLength) ? sound.getSample((int)tapIndex) : 0.0f;
+    }
+    
+    const float sample = VoiceRenderer::interpolate(interpolationMode, taps + VoiceRenderer::tapsBefore,
+                                                    VoiceRenderer::phaseFraction(span.phase)) * span.gain;
+    
+    for (int channel = 0; channel < span.numOutputChannels; ++channel)
+        span.outputs[channel][span.outputStart] += sample;
+    
+    span.phase += span.increment;
+    span.increment += (juce::uint64)span.incrementDelta;
+    span.gain += span.gainIncrement;
+    ++span.outputStart;
+}
+
+void AISamplerVoice::renderTimeStretched(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                                         const AISamplerSound& sound)
+{
+    const auto& analysis = sound.getTimeStretchAnalysis();
+    const bool looping = sound.getLoopEnd() > sound.getLoopStart() && sound.getLoopEnd() <= sound.getLength();
+    const juce::uint64 loopLength = (juce::uint64)(sound.getLoopEnd() - sound.getLoopStart()) << VoiceRenderer::phaseFractionBits;
+    
+    float* mix = decodeScratch.data();
+    int remaining = numSamples;
+    
+    while (remaining > 0)
+    {
+        if (samplesUntilNextGrain == 0)
+        {
+            startGrain(sound);
+            samplesUntilNextGrain = analysis.hop;
+        }
+        
+        // Done once the envelope or the last grain has ended
+        if (!envelope.isActive() || (!grains[0].active && !grains[1].active))
+        {
+            clearCurrentNote();
+            envelope.reset();
+            break;
+        }
+        
+        int chunk = juce::jmin(remaining, samplesUntilNextGrain, envelope.getSamplesUntilStageEnd());
+        
+        // Grains read at the bend from the middle of the chunk
+        if (bendGlide.isGliding() || pressureGlide.isGliding())
+            chunk = juce::jmin(chunk, modulationSpanLength);
+        
+        if (bendGlide.isGliding())
+            phaseIncrement = getIncrementForBend(bendGlide.peek(chunk / 2));
+        
+        std::fill(mix, mix + chunk, 0.0f);
+        
+        for (auto& grain : grains)
+            if (grain.active)
+                renderGrain(grain, sound, mix, chunk);
+        
+        // Envelope and pressure are linear within the chunk
+        float gain = envelope.getLevel() * currentVelocity * pressureGlide.current;
+        const float slope = (getGainAfter(chunk) - gain) / (float)chunk;
+        
+        for (int i = 0; i < chunk; ++i)
+        {
+            mix[i] *= gain;
+            gain += slope;
+        }
+        
+        const int outputStart = startSample + numSamples - remaining;
+        
+        for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::add(outputBuffer.getWritePointer(channel, outputStart), mix, chunk);
+        
+        envelope.advance(chunk);
+        pressureGlide.advance(chunk);
+        
+        if (bendGlide.isGliding())
+        {
+            bendGlide.advance(chunk);
+            phaseIncrement = getIncrementForBend(bendGlide.current);
+        }
+        
+        readHead += readHeadIncrement * (juce::uint64)chunk;
+        
+        while (looping && VoiceRenderer::phaseIndex(readHead) >= sound.getLoopEnd())
+            readHead -= loopLength;
+        
+        samplesUntilNextGrain -= chunk;
+        remaining -= chunk;
+    }
+}
+
+void AISamplerVoice::startGrain(const AISamplerSound& sound)
+{
+    const auto& analysis = sound.getTimeStretchAnalysis();
+    const juce::int64 target = VoiceRenderer::phaseIndex(readHead);
+    
+    // Past the end of a one-shot: let the last grains ring out
+    if (target >= sound.getLength())
+        return;
+    
+    // The finished grain's slot takes the new one
+    auto& grain = grains[0].active ? grains[1] : grains[0];
+    const auto& other = &grain == &grains[0] ? grains[1] : grains[0];
+    
+    juce::int64 start = other.active ? analysis.alignGrainStart(target, VoiceRenderer::phaseIndex(other.phase))
+                                     : target;
+    
+    if (start >= sound.getLoopEnd() && sound.getLoopEnd() > sound.getLoopStart())
+        start -= sound.getLoopEnd() - sound.getLoopStart();
+    
+    grain.phase = (juce::uint64)juce::jmax((juce::int64)0, start) << VoiceRenderer::phaseFractionBits;
+    grain.age = 0;
+    grain.active = true;
+}
+
+void AISamplerVoice::renderGrain(Grain& grain, const AISamplerSound& sound, float* mix, int numSamples)
+{
+    const auto& analysis = sound.getTimeStretchAnalysis();
+    const int sourceLength = sound.getLength();
+    const int loopStart = sound.getLoopStart();
+    const int loopEnd = sound.getLoopEnd();
+    const bool looping = loopEnd > loopStart && loopEnd <= sourceLength;
+    const juce::uint64 loopLength = (juce::uint64)(loopEnd - loopStart) << VoiceRenderer::phaseFractionBits;
+    const juce::int64 boundary = looping ? loopEnd : sourceLength;
+    const float* source = sound.isCompact() ? nullptr : sound.getAudioData().getReadPointer(0);
+    const bool interpolate = interpolationMode != InterpolationMode::DropSample;
+    
+    const int count = juce::jmin(numSamples, analysis.grainLength - grain.age);
+    const float* window = analysis.window.data() + grain.age;
+    juce::uint64 grainPhase = grain.phase;
+    
+    for (int i = 0; i < count; ++i)
+    {
+        while (looping && VoiceRenderer::phaseIndex(grainPhase) >= loopEnd)
+            grainPhase -= loopLength;
+        
+        const juce::int64 index = VoiceRenderer::phaseIndex(grainPhase);
+        float sample;
+        
+        if (source != nullptr && index + 1 < boundary)
+        {
+            sample = source[index];
             
-            float frac = (float)(sourceSamplePosition - index0);
-            float sample0 = sourceBuffer.getSample(0, index0);
-            float sample1 = sourceBuffer.getSample(0, index1);
-            float interpolatedSample = sample0 + frac * (sample1 - sample0);
-            
-            // Apply ADSR envelope and velocity
-            float envelope = adsr.getNextSample();
-            float outputSample = interpolatedSample * envelope * currentVelocity;
-            
-            // Write to output (stereo)
-            for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+            if (interpolate)
+                sample += VoiceRenderer::phaseFraction(grainPhase) * (source[index + 1] - sample);
+        }
+        else
+        {
+            // Next sample wraps to the loop start, or is silence past the end
+            auto tap = [&](juce::int64 tapIndex)
             {
-                outputBuffer.addSample(channel, startSample + i, outputSample);
-            }
+                if (looping && tapIndex >= loopEnd)
+                    tapIndex -= loopEnd - loopStart;
+                
+                return tapIndex < sourceLength ? sound.getSample((int)tapIndex) : 0.0f;
+            };
             
-            // Advance playback position with pitch shifting
-            sourceSamplePosition += pitchRatio;
+            sample = tap(index);
+            
+            if (interpolate)
+                sample += VoiceRenderer::phaseFraction(grainPhase) * (tap(index + 1) - sample);
         }
+        
+        mix[i] += window[i] * sample;
+        grainPhase += phaseIncrement;
     }
+    
+    grain.phase = grainPhase;
+    grain.age += count;
+    grain.active = grain.age < analysis.grainLength;
 }
 
 //==============================================================================
 // AISamplerEngine Implementation
 //==============================================================================
-AISamplerEngine::AISamplerEngine()
+AISamplerEngine::AISamplerEngine(int numVoices)
+    : voiceLimit(numVoices)
 {
     // Add voices
-    for (int i = 0; i < maxVoices; ++i)
+    for (int i = 0; i < numVoices; ++i)
         addVoice(new AISamplerVoice());
+    
+    // CC74 rests at its centre
+    channelTimbre.fill(0.5f);
+    
+    filterBank.prepare(numVoices);
+    voiceRows.setSize(juce::jmax(1, numVoices), VoiceFilterBank::controlInterval);
+    laneInputs.assign((size_t)filterBank.getNumLanes(), nullptr);
 }
 
-void AISamplerEngine::loadSampleFromFile(const juce::String& filePath)
+void AISamplerEngine::setInterpolationMode(InterpolationMode newMode)
 {
-    juce::File audioFile(filePath);
+    const juce::ScopedLock sl(lock);
     
-    if (!audioFile.existsAsFile())
+    interpolationMode = newMode;
+    applyVoiceInterpolation();
+}
+
+void AISamplerEngine::setPlaybackMode(PlaybackMode newMode, double timeStretchSpeed)
+{
+    const juce::ScopedLock sl(lock);
+    
+    playbackMode = newMode;
+    
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+            samplerVoice->setPlaybackMode(newMode, timeStretchSpeed);
+}
+
+void AISamplerEngine::applyVoiceInterpolation()
+{
+    // Modes are ordered from cheapest to best
+    const auto mode = juce::jmin(interpolationMode, interpolationCeiling);
+    
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+            samplerVoice->setInterpolationMode(mode);
+}
+
+void AISamplerEngine::setMPEEnabled(bool shouldBeEnabled)
+{
+    mpeEnabled = shouldBeEnabled;
+    updateVoiceBendRanges();
+}
+
+void AISamplerEngine::setPitchBendRanges(float noteRange, float masterRange)
+{
+    noteBendRange = noteRange;
+    masterBendRange = masterRange;
+    updateVoiceBendRanges();
+}
+
+void AISamplerEngine::updateVoiceBendRanges()
+{
+    const juce::ScopedLock sl(lock);
+    
+    for (auto* voice : voices)
+    {
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+        {
+            samplerVoice->setPitchBendRange(mpeEnabled ? noteBendRange : masterBendRange);
+            samplerVoice->setMasterBend(0.0f);
+        }
+    }
+}
+
+void AISamplerEngine::noteOn(int midiChannel, int midiNoteNumber, float velocity)
+{
+    const juce::ScopedLock sl(lock);
+    
+    juce::Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+    
+    if (midiChannel < 1 || midiChannel > 16)
+        return;
+    
+    // MPE controllers send a note's pressure and timbre just before it starts
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+            if (samplerVoice->getCurrentlyPlayingNote() == midiNoteNumber && samplerVoice->isPlayingChannel(midiChannel)
+                && samplerVoice->isKeyDown() && !samplerVoice->isPlayingButReleased())
+                samplerVoice->setInitialExpression(channelPressure[(size_t)midiChannel], channelTimbre[(size_t)midiChannel]);
+}
+
+void AISamplerEngine::handlePitchWheel(int midiChannel, int wheelValue)
+{
+    if (!mpeEnabled || midiChannel != mpeMasterChannel)
+    {
+        juce::Synthesiser::handlePitchWheel(midiChannel, wheelValue);
+        return;
+    }
+    
+    const float semitones = pitchWheelToSemitones(wheelValue, masterBendRange);
+    
+    const juce::ScopedLock sl(lock);
+    
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+            samplerVoice->setMasterBend(semitones);
+}
+
+void AISamplerEngine::handleController(int midiChannel, int controllerNumber, int controllerValue)
+{
+    if (controllerNumber == 74 && midiChannel >= 1 && midiChannel <= 16)
+        channelTimbre[(size_t)midiChannel] = (float)controllerValue / 127.0f;
+    
+    juce::Synthesiser::handleController(midiChannel, controllerNumber, controllerValue);
+}
+
+void AISamplerEngine::handleChannelPressure(int midiChannel, int channelPressureValue)
+{
+    if (midiChannel >= 1 && midiChannel <= 16)
+        channelPressure[(size_t)midiChannel] = (float)channelPressureValue / 127.0f;
+    
+    juce::Synthesiser::handleChannelPressure(midiChannel, channelPressureValue);
+}
+
+void AISamplerEngine::setFilterSettings(const VoiceFilterSettings& newSettings)
+{
+    const juce::ScopedLock sl(lock);
+    
+    filterSettings = newSettings;
+    
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+            samplerVoice->setFilterEnvelopeParameters(newSettings.envelope);
+}
+
+void AISamplerEngine::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    applyLoadShedding();
+    
+    if (!filterSettings.enabled)
     {
-        DBG("File does not exist: " + filePath);
+        juce::Synthesiser::renderVoices(outputAudio, startSample, numSamples);
         return;
     }
     
+    const double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    
+    while (numSamples > 0)
+    {
+        // Cutoffs move on a fixed grid, whatever the block and event split;
+        // a new note gets its own straight away
+        const bool updateAll = samplesUntilFilterUpdate == 0;
+        
+        if (updateAll)
+            samplesUntilFilterUpdate = VoiceFilterBank::controlInterval;
+        
+        const int count = juce::jmin(numSamples, samplesUntilFilterUpdate);
+        
+        // Every sounding voice renders mono into its own row
+        for (int i = 0; i < voices.size(); ++i)
+        {
+            auto* voice = dynamic_cast<AISamplerVoice*>(voices.getUnchecked(i));
+            laneInputs[(size_t)i] = nullptr;
+            
+            if (voice == nullptr || !voice->isVoiceActive())
+                continue;
+            
+            const bool newNote = voice->takeFilterReset();
+            
+            if (newNote)
+                filterBank.resetLane(i);
+            
+            if (updateAll || newNote)
+                filterBank.setCoefficients(i, filterSettings.type, voice->getFilterCutoff(filterSettings),
+                                           filterSettings.resonance, sampleRate);
+            
+            float* row = voiceRows.getWritePointer(i);
+            juce::FloatVectorOperations::clear(row, count);
+            
+            juce::AudioBuffer<float> rowBuffer(&row, 1, count);
+            voice->renderNextBlock(rowBuffer, 0, count);
+            voice->advanceFilterEnvelope(count);
+            
+            laneInputs[(size_t)i] = row;
+        }
+        
+        juce::FloatVectorOperations::clear(filterMix.data(), count);
+        filterBank.process(laneInputs.data(), filterMix.data(), count);
+        
+        // Voices are mono, so the mix goes to every channel
+        for (int channel = 0; channel < outputAudio.getNumChannels(); ++channel)
+            outputAudio.addFrom(channel, startSample, filterMix.data(), count);
+        
+        startSample += count;
+        numSamples -= count;
+        samplesUntilFilterUpdate -= count;
+    }
+}
+
+void AISamplerEngine::fadeOutQuietestReleasedVoices(int maxVoices, double fadeSeconds)
+{
+    shedFadeSeconds.store(fadeSeconds);
+    voicesToShed.store(maxVoices);
+}
+
+void AISamplerEngine::applyLoadShedding()
+{
+    const auto ceiling = requestedCeiling.load();
+    
+    if (ceiling != interpolationCeiling)
+    {
+        interpolationCeiling = ceiling;
+        applyVoiceInterpolation();
+    }
+    
+    const int numToShed = voicesToShed.exchange(0);
+    const double fadeSeconds = shedFadeSeconds.load();
+    
+    for (int n = 0; n < numToShed; ++n)
+    {
+        AISamplerVoice* quietest = nullptr;
+        
+        for (auto* voice : voices)
+            if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+                if (samplerVoice->isVoiceActive() && samplerVoice->isReleasing() && !samplerVoice->isFadingOut()
+                    && (quietest == nullptr || samplerVoice->getCurrentLevel() < quietest->getCurrentLevel()))
+                    quietest = samplerVoice;
+        
+        if (quietest == nullptr)
+            break;
+        
+        quietest->fadeOut(fadeSeconds);
+    }
+}
+
+juce::SynthesiserVoice* AISamplerEngine::findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                                       int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    const int limit = voiceLimit.load();
+    
+    if (limit < voices.size())
+    {
+        int numActive = 0;
+        juce::SynthesiserVoice* oldestReleased = nullptr;
+        juce::SynthesiserVoice* oldest = nullptr;
+        
+        for (auto* voice : voices)
+        {
+            if (!voice->isVoiceActive() || !voice->canPlaySound(soundToPlay))
+                continue;
+            
+            ++numActive;
+            
+            if (oldest == nullptr || voice->wasStartedBefore(*oldest))
+                oldest = voice;
+            
+            if (voice->isPlayingButReleased() && (oldestReleased == nullptr || voice->wasStartedBefore(*oldestReleased)))
+                oldestReleased = voice;
+        }
+        
+        // Over the limit every new note steals, whatever the stealing
+        // setting: a released note if there is one, else the oldest
+        if (numActive >= limit)
+            return oldestReleased != nullptr ? oldestReleased : oldest;
+    }
+    
+    return Synthesiser::findFreeVoice(soundToPlay, midiChannel, midiNoteNumber, stealIfNoneAvailable);
+}
+
+AISamplerSound::Ptr AISamplerEngine::getSoundForNote(int midiNoteNumber) const
+{
+    const juce::SpinLock::ScopedLockType sl(loadedLock);
+    
+    for (auto& sound : loadedSounds)
+        if (sound->appliesToNote(midiNoteNumber))
+            return sound;
+    
+    return loadedSounds.empty() ? nullptr : loadedSounds.front();
+}
+
+juce::String AISamplerEngine::getLoadedSampleInfo() const
+{
+    const juce::SpinLock::ScopedLockType sl(loadedLock);
+    return sampleInfo;
+}
+
+int AISamplerEngine::getPlayPositions(const AISamplerSound* sound, int* positions, int maxPositions) const
+{
+    int count = 0;
+    
+    // No lock: each voice publishes its position and sound atomically
+    for (auto* voice : voices)
+    {
+        if (count >= maxPositions)
+            break;
+        
+        if (auto* samplerVoice = dynamic_cast<AISamplerVoice*>(voice))
+        {
+            const int position = samplerVoice->getPlayPosition();
+            
+            if (position >= 0 && samplerVoice->getPlayPositionSound() == sound)
+                positions[count++] = position;
+        }
+    }
+    
+    return count;
+}
+
+bool AISamplerEngine::isAnyVoiceActive() const
+{
+    for (auto* voice : voices)
+        if (voice->isVoiceActive())
+            return true;
+    
+    return false;
+}
+
+void AISamplerEngine::loadSampleFromFile(const juce::String& filePath, const SampleAnalysis& analysis)
+{
+    juce::AudioBuffer<float> buffer;
+    double sampleRate = 0.0;
+    
+    if (readMonoFile(juce::File(filePath), buffer, sampleRate))
+        processLoadedBuffer(buffer, sampleRate, analysis);
+}
+
+void AISamplerEngine::loadSampleFromBuffer(juce::AudioBuffer<float>& buffer, int rootNote)
+{
+    processLoadedBuffer(buffer, 44100.0); // Assume 44.1kHz for now
+}
+
+bool AISamplerEngine::loadMultisampleFromFiles(const juce::StringArray& filePaths,
+                                               const juce::Array<int>& zoneNotes,
+                                               const std::vector<SampleAnalysis>& analyses)
+{
+    jassert(filePaths.size() == zoneNotes.size());
+    
+    // Decode and analyse every zone in parallel
+    auto sounds = analyseFiles(filePaths, zoneNotes, analyses);
+    mapKeyZones(sounds, zoneNotes);
+    
+    if (sounds.empty())
+        return false;
+    
+    juce::StringArray roots;
+    for (auto& sound : sounds)
+        roots.add(juce::String(sound->getRootNote()));
+    
+    loadPreparedSounds(sounds, "Zones: " + juce::String((int)sounds.size())
+                                 + ", Roots: " + roots.joinIntoString(" "));
+    return true;
+}
+
+void AISamplerEngine::loadPreparedSounds(const std::vector<AISamplerSound::Ptr>& preparedSounds,
+                                         const juce::String& info)
+{
+    std::vector<AISamplerSound::Ptr> toLoad;
+    
+    for (auto& sound : preparedSounds)
+    {
+        if (sound == nullptr)
+            continue;
+        
+        if (compactStorage)
+            sound->makeCompact();
+        
+        toLoad.push_back(sound);
+    }
+    
+    clearSounds();
+    
+    for (auto& sound : toLoad)
+        addSound(sound.get());
+    
+    sampleLoaded = !toLoad.empty();
+    
+    {
+        const juce::SpinLock::ScopedLockType sl(loadedLock);
+        loadedSounds.swap(toLoad);
+        sampleInfo = info;
+    }
+    
+    DBG("Sounds loaded: " + info);
+}
+
+void AISamplerEngine::mapKeyZones(std::vector<AISamplerSound::Ptr>& sounds,
+                                  const juce::Array<int>& zoneNotes)
+{
+    jassert((int)sounds.size() <= zoneNotes.size());
+    
+    std::vector<std::pair<int, AISamplerSound::Ptr>> zones;
+    for (size_t i = 0; i < sounds.size(); ++i)
+        if (sounds[i] != nullptr)
+            zones.emplace_back(zoneNotes[(int)i], sounds[i]);
+    
+    std::sort(zones.begin(), zones.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    
+    sounds.clear();
+    
+    for (size_t z = 0; z < zones.size(); ++z)
+    {
+        const int note = zones[z].first;
+        const int low = z == 0 ? 0 : (zones[z - 1].first + note) / 2 + 1;
+        const int high = z == zones.size() - 1 ? 127 : (note + zones[z + 1].first) / 2;
+        
+        zones[z].second->setNoteRange(low, high);
+        sounds.push_back(zones[z].second);
+    }
+}
+
+std::vector<AISamplerSound::Ptr> AISamplerEngine::analyseFiles(const juce::StringArray& filePaths,
+                                                               const juce::Array<int>& expectedRootNotes,
+                                                               const std::vector<SampleAnalysis>& analyses)
+{
+    juce::SharedResourcePointer<AnalysisThreadPool> pool;
+    
+    std::vector<AISamplerSound::Ptr> sounds((size_t)filePaths.size());
+    std::vector<AnalysisTask::Ptr> tasks;
+    tasks.reserve(sounds.size());
+    
+    for (int i = 0; i < filePaths.size(); ++i)
+    {
+        const auto path = filePaths[i];
+        const int expectedRoot = i < expectedRootNotes.size() ? expectedRootNotes[i] : -1;
+        const auto analysis = (size_t)i < analyses.size() ? analyses[(size_t)i] : SampleAnalysis();
+        auto* slot = &sounds[(size_t)i];
+        
+        tasks.push_back(AnalysisTask::launch(*pool, [path, expectedRoot, analysis, slot]
+        {
+            juce::AudioBuffer<float> buffer;
+            double sampleRate = 0.0;
+            
+            if (readMonoFile(juce::File(path), buffer, sampleRate))
+            {
+                *slot = createSoundFromAnalysis(buffer, sampleRate, analysis);
+                
+                if (*slot == nullptr)
+                    *slot = createAnalysedSound(buffer, sampleRate, expectedRoot);
+            }
+        }));
+    }
+    
+    // The calling thread picks up files no worker has started yet
+    for (auto& task : tasks)
+        task->waitOrRun();
+    
+    return sounds;
+}
+
+bool AISamplerEngine::readMonoFile(const juce::File& audioFile,
+                                   juce::AudioBuffer<float>& buffer, double& sampleRate)
+{
+    if (!audioFile.existsAsFile())
+    {
+        DBG("File does not exist: " + audioFile.getFullPathName());
+        return false;
+    }
+    
     juce::AudioFormatManager formatManager;
     formatManager.registerBasicFormats();
     
@@ -154,12 +1100,13 @@ void AISamplerEngine::loadSampleFromFile(const juce::String& filePath)
     
     if (reader == nullptr)
     {
-        DBG("Failed to create reader for: " + filePath);
-        return;
+        DBG("Failed to create reader for: " + audioFile.getFullPathName());
+        return false;
     }
     
-    juce::AudioBuffer<float> buffer((int)reader->numChannels, (int)reader->lengthInSamples);
+    buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
     reader->read(&buffer, 0, (int)reader->lengthInSamples, 0, true, true);
+    sampleRate = reader->sampleRate;
     
     // Convert to mono if stereo
     if (buffer.getNumChannels() > 1)
@@ -175,15 +1122,25 @@ void AISamplerEngine::loadSampleFromFile(const juce::String& filePath)
         buffer.setSize(1, buffer.getNumSamples(), true);
     }
     
-    processLoadedBuffer(buffer, reader->sampleRate);
+    return true;
 }
 
-void AISamplerEngine::loadSampleFromBuffer(juce::AudioBuffer<float>& buffer, int rootNote)
+void AISamplerEngine::processLoadedBuffer(juce::AudioBuffer<float>& buffer, double sampleRate,
+                                          const SampleAnalysis& analysis)
 {
-    processLoadedBuffer(buffer, 44100.0); // Assume 44.1kHz for now
+    auto sound = createSoundFromAnalysis(buffer, sampleRate, analysis);
+    
+    if (sound == nullptr)
+        sound = createAnalysedSound(buffer, sampleRate);
+    
+    loadPreparedSounds({ sound }, juce::String::formatted("Root: %d, Length: %.2fs, Loop: %d-%d",
+                                                          sound->getRootNote(),
+                                                          sound->getLength() / sampleRate,
+                                                          sound->getLoopStart(), sound->getLoopEnd()));
 }
 
-void AISamplerEngine::processLoadedBuffer(juce::AudioBuffer<float>& buffer, double sampleRate)
+AISamplerSound::Ptr AISamplerEngine::createAnalysedSound(juce::AudioBuffer<float>& buffer, double sampleRate,
+                                                         int expectedRootNote)
 {
     // Step 1: Trim silence
     trimSilence(buffer);
@@ -191,27 +1148,47 @@ void AISamplerEngine::processLoadedBuffer(juce::AudioBuffer<float>& buffer, doub
     // Step 2: Normalize
     normalize(buffer);
     
-    // Step 3: Detect pitch
-    int rootNote = detectPitch(buffer, sampleRate);
+    // Step 3: Detect pitch on the pool while this thread searches for loop
+    // points; both only read the trimmed, normalized buffer
+    juce::SharedResourcePointer<AnalysisThreadPool> pool;
+    const juce::AudioBuffer<float>& analysed = buffer;
+    int rootNote = 60;
+    
+    auto pitchTask = AnalysisTask::launch(*pool, [&analysed, &rootNote, sampleRate, expectedRootNote]
+    {
+        rootNote = detectPitch(analysed, sampleRate, expectedRootNote);
+    });
     
     // Step 4: Find loop points
     int loopStart = 0;
     int loopEnd = buffer.getNumSamples();
-    findLoopPoints(buffer, loopStart, loopEnd);
+    findLoopPoints(analysed, loopStart, loopEnd);
     
-    // Step 5: Create sampler sound and load it
-    clearSounds();
-    auto* sound = new AISamplerSound("Generated", buffer, rootNote, sampleRate);
+    pitchTask->waitOrRun();
+    
+    // Step 5: Create sampler sound
+    AISamplerSound::Ptr sound = new AISamplerSound("Generated", buffer, rootNote, sampleRate);
     sound->setLoopPoints(loopStart, loopEnd);
-    addSound(sound);
     
-    sampleLoaded = true;
-    sampleInfo = juce::String::formatted("Root: %d, Length: %.2fs, Loop: %d-%d",
-                                         rootNote,
-                                         buffer.getNumSamples() / sampleRate,
-                                         loopStart, loopEnd);
+    return sound;
+}
+
+AISamplerSound::Ptr AISamplerEngine::createSoundFromAnalysis(juce::AudioBuffer<float>& buffer, double sampleRate,
+                                                             const SampleAnalysis& analysis)
+{
+    if (!analysis.isTrustedFor(buffer.getNumSamples(), sampleRate))
+    {
+        if (analysis.present)
+            DBG("Ignoring backend analysis that does not match the decoded file");
+        
+        return nullptr;
+    }
+    
+    // The backend already trimmed and normalized the file
+    AISamplerSound::Ptr sound = new AISamplerSound("Generated", buffer, analysis.rootNote, sampleRate);
+    sound->setLoopPoints(analysis.loopStart, analysis.loopEnd);
     
-    DBG("Sample loaded: " + sampleInfo);
+    return sound;
 }
 
 void AISamplerEngine::trimSilence(juce::AudioBuffer<float>& buffer)
@@ -275,7 +1252,8 @@ void AISamplerEngine::normalize(juce::AudioBuffer<float>& buffer, float targetDB
     }
 }
 
-int AISamplerEngine::detectPitch(const juce::AudioBuffer<float>& buffer, double sampleRate)
+int AISamplerEngine::detectPitch(const juce::AudioBuffer<float>& buffer, double sampleRate,
+                                 int expectedRootNote)
 {
     // Use autocorrelation-based pitch detection
     PitchDetector detector;
@@ -286,16 +1264,19 @@ int AISamplerEngine::detectPitch(const juce::AudioBuffer<float>& buffer, double
         // Convert frequency to MIDI note
         // A4 (MIDI 69) = 440 Hz
         // MIDI note = 69 + 12 * log2(freq / 440)
-        int midiNote = 69 + (int)(12.0f * std::log2(frequency / 440.0f));
+        int midiNote = 69 + juce::roundToInt(12.0f * std::log2(frequency / 440.0f));
         
         // Clamp to reasonable range
         midiNote = juce::jlimit(0, 127, midiNote);
         
-        return midiNote;
+        // When the note the sample was generated for is known, an answer
+        // more than an octave away is an octave error rather than the pitch
+        if (expectedRootNote < 0 || std::abs(midiNote - expectedRootNote) <= 12)
+            return midiNote;
     }
     
-    // Default to C3 if detection fails
-    return 60;
+    // Fall back to the expected note, or C3 if detection fails
+    return expectedRootNote >= 0 ? expectedRootNote : 60;
 }
 
 void AISamplerEngine::findLoopPoints(const juce::AudioBuffer<float>& buffer, int& loopStart, int& loopEnd)
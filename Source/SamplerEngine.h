@@ -1,39 +1,91 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CompactSampleBuffer.h"
+#include "SampleAnalysis.h"
+#include "TimeStretch.h"
+#include "VoiceEnvelope.h"
+#include "VoiceFilterBank.h"
+#include "VoiceRenderer.h"
+#include "WaveformPeaks.h"
 
 //==============================================================================
 // Custom sampler sound that stores our generated audio
 class AISamplerSound : public juce::SynthesiserSound
 {
 public:
+    using Ptr = juce::ReferenceCountedObjectPtr<AISamplerSound>;
+    
     AISamplerSound(const juce::String& name,
                    juce::AudioBuffer<float>& source,
                    int rootMidiNote,
                    double sampleRate);
     
-    bool appliesToNote(int midiNoteNumber) override { return true; }
+    bool appliesToNote(int midiNoteNumber) override
+    {
+        return midiNoteNumber >= lowNote && midiNoteNumber <= highNote;
+    }
     bool appliesToChannel(int midiChannel) override { return true; }
     
+    // Float sample data; empty once the sound has been made compact
     const juce::AudioBuffer<float>& getAudioData() const { return audioData; }
     int getRootNote() const { return rootNote; }
     double getSourceSampleRate() const { return sourceSampleRate; }
     int getLoopStart() const { return loopStart; }
     int getLoopEnd() const { return loopEnd; }
-    int getLength() const { return audioData.getNumSamples(); }
+    int getLength() const { return length; }
+    
+    // Swaps the float data for 16-bit block-scaled storage, roughly halving
+    // its memory. Call before the sound is handed to an engine.
+    void makeCompact();
+    bool isCompact() const { return compact; }
+    const CompactSampleBuffer& getCompactData() const { return compactData; }
+    size_t getSizeInBytes() const;
+    
+    // Grain window and pitch marks, computed when the sound is created
+    const TimeStretchAnalysis& getTimeStretchAnalysis() const { return timeStretch; }
+    
+    // Min/max overview for the editor, also computed up front
+    const WaveformPeaks& getWaveformPeaks() const { return peaks; }
+    
+    float getSample(int index) const
+    {
+        return compact ? compactData.getSample(index) : audioData.getSample(0, index);
+    }
     
     void setLoopPoints(int start, int end)
     {
         loopStart = start;
         loopEnd = end;
     }
+    
+    // Key zone this sound answers to (whole keyboard by default)
+    void setNoteRange(int low, int high)
+    {
+        lowNote = low;
+        highNote = high;
+    }
 
 private:
     juce::AudioBuffer<float> audioData;
+    CompactSampleBuffer compactData;
+    TimeStretchAnalysis timeStretch;
+    WaveformPeaks peaks;
+    bool compact = false;
+    int length = 0;
     int rootNote;
     double sourceSampleRate;
     int loopStart = 0;
     int loopEnd = 0;
+    int lowNote = 0;
+    int highNote = 127;
+};
+
+//==============================================================================
+enum class PlaybackMode
+{
+    resample,       // pitch by playback speed; higher notes are shorter
+    timeStretch     // overlapping grains; same length on every note
 };
 
 //==============================================================================
@@ -51,21 +103,164 @@ public:
     
     void stopNote(float velocity, bool allowTailOff) override;
     
-    void pitchWheelMoved(int newPitchWheelValue) override {}
-    void controllerMoved(int controllerNumber, int newControllerValue) override {}
+    // Expression from the note's channel: with MPE every note has its own.
+    // Bend and pressure glide to new values instead of stepping.
+    void pitchWheelMoved(int newPitchWheelValue) override;
+    void controllerMoved(int controllerNumber, int newControllerValue) override;
+    void channelPressureChanged(int newChannelPressureValue) override;
+    void aftertouchChanged(int newAftertouchValue) override;
+    
+    // Bend shared by every note (the MPE master channel), in semitones
+    void setMasterBend(float semitones);
+    void setPitchBendRange(float semitones) { pitchBendRange = semitones; }
+    
+    // Pressure and timbre sent on the channel before the note started
+    void setInitialExpression(float pressure, float timbre);
+    
+    // CC74, 0..1
+    float getTimbre() const { return timbre; }
+    
+    //==============================================================================
+    // The filter itself runs in the engine's VoiceFilterBank; the voice
+    // keeps the filter envelope and works out where its cutoff is
+    void setFilterEnvelopeParameters(const juce::ADSR::Parameters& newParameters);
+    float getFilterCutoff(const VoiceFilterSettings& settings) const;
+    void advanceFilterEnvelope(int numSamples);
+    
+    // True once after each new note, which starts with a cleared filter
+    bool takeFilterReset() { return std::exchange(filterNeedsReset, false); }
     
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer,
                          int startSample, int numSamples) override;
+    
+    void setInterpolationMode(InterpolationMode newMode) { interpolationMode = newMode; }
+    
+    // Takes effect from the next note
+    void setPlaybackMode(PlaybackMode newMode, double timeStretchSpeed);
+    
+    // Level actually reaching the output, for picking voices to shed
+    float getCurrentLevel() const { return envelope.getLevel() * currentVelocity; }
+    bool isReleasing() const { return envelope.getStage() == VoiceEnvelope::Stage::release; }
+    bool isFadingOut() const { return fadingOut; }
+    
+    // Cuts a released note short with a fade instead of a click
+    void fadeOut(double seconds);
+    
+    // Source position reached at the end of the last block, or -1 when
+    // silent. Written by the audio thread, for drawing a playhead.
+    int getPlayPosition() const { return playPosition.load(std::memory_order_relaxed); }
+    const AISamplerSound* getPlayPositionSound() const { return playPositionSound.load(std::memory_order_relaxed); }
 
 private:
+    // Source samples of compact sounds are decoded here a span at a time;
+    // time-stretched playback mixes its grains here instead
+    static constexpr int decodeScratchSize = 1024;
+    static_assert(TimeStretchAnalysis::maxGrainLength / 2 <= decodeScratchSize, "a grain hop must fit the scratch");
+    
+    // Expression glides are applied in spans of at most this many samples,
+    // short enough that a linear ramp of the increment tracks the curve
+    static constexpr int modulationSpanLength = 32;
+    static constexpr double bendGlideSeconds = 0.005;
+    static constexpr double pressureGlideSeconds = 0.01;
+    
+    // Linear glide to a target, read ahead at span ends
+    struct Glide
+    {
+        float current = 0.0f;
+        float target = 0.0f;
+        float step = 0.0f;
+        int samplesLeft = 0;
+        
+        void reset(float value) { current = target = value; step = 0.0f; samplesLeft = 0; }
+        
+        void setTarget(float newTarget, int rampSamples)
+        {
+            target = newTarget;
+            samplesLeft = juce::jmax(1, rampSamples);
+            step = (target - current) / (float)samplesLeft;
+        }
+        
+        bool isGliding() const { return samplesLeft > 0; }
+        float peek(int numSamples) const { return numSamples >= samplesLeft ? target : current + step * (float)numSamples; }
+        
+        void advance(int numSamples)
+        {
+            current = peek(numSamples);
+            samplesLeft = juce::jmax(0, samplesLeft - numSamples);
+        }
+    };
+    
     double pitchRatio = 1.0;
-    double sourceSamplePosition = 0.0;
+    double baseIncrementRatio = 1.0;    // source samples per output sample, unbent
+    juce::uint64 phase = 0;             // 32.32 fixed-point source position
+    juce::uint64 phaseIncrement = 0;
+    
+    float pitchBendRange = 2.0f;
+    float noteBendSemitones = 0.0f;
+    float masterBendSemitones = 0.0f;
+    Glide bendGlide;                    // semitones
+    Glide pressureGlide;                // gain multiplier
+    float timbre = 0.5f;
     float currentVelocity = 0.0f;
+    InterpolationMode interpolationMode = InterpolationMode::Linear;
+    bool fadingOut = false;
+    
+    PlaybackMode playbackMode = PlaybackMode::resample;
+    PlaybackMode notePlaybackMode = PlaybackMode::resample;
+    double stretchSpeed = 1.0;
+    
+    // Time-stretch state: two grains overlap at any time, started every hop
+    // from the read head, which moves at the sample's own speed
+    struct Grain
+    {
+        juce::uint64 phase = 0;
+        int age = 0;                    // samples played, indexes the window
+        bool active = false;
+    };
+    
+    std::array<Grain, 2> grains;
+    juce::uint64 readHead = 0;
+    juce::uint64 readHeadIncrement = 0;
+    int samplesUntilNextGrain = 0;
     
-    juce::ADSR adsr;
+    std::atomic<int> playPosition { -1 };
+    std::atomic<const AISamplerSound*> playPositionSound { nullptr };
+    
+    VoiceEnvelope envelope;
     juce::ADSR::Parameters adsrParams;
+    VoiceEnvelope filterEnvelope;
+    bool filterNeedsReset = false;
+    std::array<float, decodeScratchSize> decodeScratch;
     
     void updatePitchRatio(int midiNote, AISamplerSound* sound);
+    void publishPlayPosition(const AISamplerSound* sound);
+    void updateBendTarget();
+    int glideSamples(double seconds) const;
+    
+    juce::uint64 getIncrementForBend(float semitones) const;
+    
+    // Envelope, velocity and pressure gain numSamples from now
+    float getGainAfter(int numSamples) const;
+    
+    // One sample with its taps fetched one by one, for positions where the
+    // kernel's taps would run past the loop or the ends of the source
+    void renderSampleAtBoundary(VoiceRenderer::Span& span, const AISamplerSound& sound, bool looping);
+    
+    void renderTimeStretched(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                             const AISamplerSound& sound);
+    void startGrain(const AISamplerSound& sound);
+    void renderGrain(Grain& grain, const AISamplerSound& sound, float* mix, int numSamples);
+};
+
+//==============================================================================
+// One analysis worker per core, shared through juce::SharedResourcePointer.
+// It exists while anything holds a pointer to it: every engine does, and
+// code that analyses sounds without an engine should hold one around its
+// loop, or each call starts and joins a fresh set of threads.
+class AnalysisThreadPool : public juce::ThreadPool
+{
+public:
+    AnalysisThreadPool() : juce::ThreadPool(juce::jmax(1, juce::SystemStats::getNumCpus())) {}
 };
 
 //==============================================================================
@@ -73,23 +268,173 @@ private:
 class AISamplerEngine : public juce::Synthesiser
 {
 public:
-    AISamplerEngine();
+    explicit AISamplerEngine(int numVoices = maxVoices);
     
-    void loadSampleFromFile(const juce::String& filePath);
+    // A trusted analysis (see SampleAnalysis::isTrustedFor) replaces trim,
+    // normalize, pitch detection and loop search
+    void loadSampleFromFile(const juce::String& filePath, const SampleAnalysis& analysis = {});
     void loadSampleFromBuffer(juce::AudioBuffer<float>& buffer, int rootNote = 60);
     
-    bool hasSampleLoaded() const { return sampleLoaded; }
-    juce::String getLoadedSampleInfo() const { return sampleInfo; }
+    // Builds a multi-zone instrument, one file per zone. Files are decoded
+    // and analysed in parallel; zoneNotes gives the note each file was
+    // generated for and decides where the keyboard splits.
+    bool loadMultisampleFromFiles(const juce::StringArray& filePaths,
+                                  const juce::Array<int>& zoneNotes,
+                                  const std::vector<SampleAnalysis>& analyses = {});
+    
+    // Installs already analysed sounds, replacing the current ones. Sounds
+    // are only read while rendering, so several engines may share them.
+    // With compact storage on, any that aren't compact yet are made compact
+    // first; share only compact sounds with such an engine.
+    void loadPreparedSounds(const std::vector<AISamplerSound::Ptr>& preparedSounds,
+                            const juce::String& info);
+    
+    // Resampling quality used by every voice (Linear by default)
+    void setInterpolationMode(InterpolationMode newMode);
+    InterpolationMode getInterpolationMode() const { return interpolationMode; }
+    
+    //==============================================================================
+    // Load shedding, driven by QualityGovernor from the audio thread. These
+    // never lock: they leave requests that the next render carries out while
+    // it holds the voice lock anyway.
+    
+    // Voices use the cheaper of this and the interpolation mode
+    void setInterpolationCeiling(InterpolationMode newCeiling) { requestedCeiling.store(newCeiling); }
+    
+    // Once this many voices sound, new notes steal instead of adding one
+    void setVoiceLimit(int newLimit) { voiceLimit.store(juce::jlimit(1, getNumVoices(), newLimit)); }
+    int getVoiceLimit() const { return voiceLimit.load(); }
+    
+    // Fades out up to maxVoices of the quietest released voices at the
+    // start of the next render
+    void fadeOutQuietestReleasedVoices(int maxVoices, double fadeSeconds);
+    
+    //==============================================================================
+    // Resampling ties duration to pitch; time-stretched playback keeps the
+    // sample's length (divided by speed) on every key
+    void setPlaybackMode(PlaybackMode newMode, double timeStretchSpeed = 1.0);
+    PlaybackMode getPlaybackMode() const { return playbackMode; }
+    
+    //==============================================================================
+    // MPE (lower zone, master channel 1): notes on channels 2-16 get their
+    // own bend, pressure and timbre (CC74), and a bend on channel 1 moves
+    // every note. Off, a channel's bend moves that channel's notes.
+    void setMPEEnabled(bool shouldBeEnabled);
+    bool isMPEEnabled() const { return mpeEnabled.load(); }
+    
+    // In semitones; the note range applies to member channels in MPE mode
+    void setPitchBendRanges(float noteRange, float masterRange);
+    
+    //==============================================================================
+    // Per-voice filter; when enabled every voice renders into its own row
+    // and the rows are filtered together (see VoiceFilterBank)
+    void setFilterSettings(const VoiceFilterSettings& newSettings);
+    const VoiceFilterSettings& getFilterSettings() const { return filterSettings; }
+    
+    // Store samples loaded from now on as 16-bit block-scaled data
+    void setCompactSampleStorage(bool shouldBeCompact) { compactStorage = shouldBeCompact; }
+    bool isCompactSampleStorage() const { return compactStorage.load(); }
+    
+    bool hasSampleLoaded() const { return sampleLoaded.load(); }
+    
+    // The sound a note would play, for display. Looks in the copy published
+    // at load time, so the editor never takes the synth lock.
+    AISamplerSound::Ptr getSoundForNote(int midiNoteNumber) const;
+    
+    // Play positions of the voices sounding from sound; returns how many
+    // were written. Safe to call from the message thread.
+    int getPlayPositions(const AISamplerSound* sound, int* positions, int maxPositions) const;
+    
+    // Cheap enough for the audio thread
+    bool isAnyVoiceActive() const;
+    juce::String getLoadedSampleInfo() const;
+    
+    //==============================================================================
+    // Analysis pipeline, usable without an engine instance
+    
+    // Decodes and analyses several files at once on the shared analysis
+    // pool. The result lines up with filePaths; unreadable files give nullptr.
+    static std::vector<AISamplerSound::Ptr> analyseFiles(const juce::StringArray& filePaths,
+                                                         const juce::Array<int>& expectedRootNotes = {},
+                                                         const std::vector<SampleAnalysis>& analyses = {});
+    
+    // Trim -> normalize -> (pitch detection || loop search); returns a sound
+    // ready to be added to an engine
+    static AISamplerSound::Ptr createAnalysedSound(juce::AudioBuffer<float>& buffer, double sampleRate,
+                                                   int expectedRootNote = -1);
+    
+    // Builds a sound straight from backend analysis, or returns nullptr if
+    // the analysis does not match the buffer
+    static AISamplerSound::Ptr createSoundFromAnalysis(juce::AudioBuffer<float>& buffer, double sampleRate,
+                                                       const SampleAnalysis& analysis);
+    
+    // Gives each sound the key range around its zone note, splitting halfway
+    // between neighbours. Drops null entries and sorts by zone note.
+    static void mapKeyZones(std::vector<AISamplerSound::Ptr>& sounds,
+                            const juce::Array<int>& zoneNotes);
+    
+    static bool readMonoFile(const juce::File& audioFile,
+                             juce::AudioBuffer<float>& buffer, double& sampleRate);
 
 private:
-    bool sampleLoaded = false;
+    juce::SharedResourcePointer<AnalysisThreadPool> analysisPool;
+    
+    std::atomic<bool> sampleLoaded { false };
+    std::atomic<bool> compactStorage { false };
+    
+    // What was loaded last, for display; never touched by the audio thread
+    mutable juce::SpinLock loadedLock;
+    std::vector<AISamplerSound::Ptr> loadedSounds;
     juce::String sampleInfo;
     
+    InterpolationMode interpolationMode = InterpolationMode::Linear;
+    InterpolationMode interpolationCeiling = InterpolationMode::Hermite;     // in effect, under lock
+    
+    std::atomic<InterpolationMode> requestedCeiling { InterpolationMode::Hermite };
+    std::atomic<int> voiceLimit;
+    std::atomic<int> voicesToShed { 0 };
+    std::atomic<double> shedFadeSeconds { 0.01 };
+    
+    PlaybackMode playbackMode = PlaybackMode::resample;
+    
     static constexpr int maxVoices = 16;
+    static constexpr int mpeMasterChannel = 1;
+    
+    std::atomic<bool> mpeEnabled { false };    // read by handlePitchWheel outside the lock
+    float noteBendRange = 48.0f;
+    float masterBendRange = 2.0f;
+    
+    // Last pressure and CC74 per channel (1-16), for notes that start after them
+    std::array<float, 17> channelPressure {};
+    std::array<float, 17> channelTimbre {};
+    
+    VoiceFilterSettings filterSettings;
+    VoiceFilterBank filterBank;
+    juce::AudioBuffer<float> voiceRows;     // one row of controlInterval samples per voice
+    std::vector<const float*> laneInputs;
+    std::array<float, VoiceFilterBank::controlInterval> filterMix;
+    int samplesUntilFilterUpdate = 0;
+    
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                          int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    void updateVoiceBendRanges();
+    
+    // Both expect the lock to be held
+    void applyVoiceInterpolation();
+    void applyLoadShedding();
+    
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
+    void handlePitchWheel(int midiChannel, int wheelValue) override;
+    void handleController(int midiChannel, int controllerNumber, int controllerValue) override;
+    void handleChannelPressure(int midiChannel, int channelPressureValue) override;
+    
+    using juce::Synthesiser::renderVoices;
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
     
-    void processLoadedBuffer(juce::AudioBuffer<float>& buffer, double sampleRate);
-    void trimSilence(juce::AudioBuffer<float>& buffer);
-    void normalize(juce::AudioBuffer<float>& buffer, float targetDB = -0.5f);
-    int detectPitch(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    void findLoopPoints(const juce::AudioBuffer<float>& buffer, int& loopStart, int& loopEnd);
+    void processLoadedBuffer(juce::AudioBuffer<float>& buffer, double sampleRate,
+                             const SampleAnalysis& analysis = {});
+    static void trimSilence(juce::AudioBuffer<float>& buffer);
+    static void normalize(juce::AudioBuffer<float>& buffer, float targetDB = -0.5f);
+    static int detectPitch(const juce::AudioBuffer<float>& buffer, double sampleRate, int expectedRootNote = -1);
+    static void findLoopPoints(const juce::AudioBuffer<float>& buffer, int& loopStart, int& loopEnd);
 };
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Deterministic test material shared by the benchmarks and regression checks
+namespace SyntheticSignals
+{
+    // Decaying harmonic tone, close enough to a generated instrument note
+    // for analysis and playback costs
+    inline juce::AudioBuffer<float> makeTone(float frequency, double seconds, double sampleRate)
+    {
+        const int numSamples = (int)(seconds * sampleRate);
+        juce::AudioBuffer<float> buffer(1, numSamples);
+        auto* data = buffer.getWritePointer(0);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double t = i / sampleRate;
+            double sample = 0.0;
+
+            for (int harmonic = 1; harmonic <= 4; ++harmonic)
+                sample += std::sin(juce::MathConstants<double>::twoPi * frequency * harmonic * t) / harmonic;
+
+            data[i] = (float)(0.5 * sample * std::exp(-1.5 * t));
+        }
+
+        return buffer;
+    }
+}
@@ -0,0 +1,74 @@
+#include "TimeStretch.h"
+
+TimeStretchAnalysis TimeStretchAnalysis::analyse(const float* source, int numSamples, double periodSamples)
+{
+    TimeStretchAnalysis analysis;
+
+    if (source == nullptr || numSamples <= 0 || periodSamples < 2.0)
+        return analysis;
+
+    analysis.grainLength = juce::jlimit(minGrainLength, maxGrainLength, 2 * juce::roundToInt(2.0 * periodSamples));
+    analysis.hop = analysis.grainLength / 2;
+
+    analysis.window.resize((size_t)analysis.grainLength);
+
+    for (int i = 0; i < analysis.grainLength; ++i)
+        analysis.window[(size_t)i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i
+                                                            / (float)analysis.grainLength);
+
+    // Marks on the largest peak of each period: start from the largest
+    // sample in the first period, then search a window around each next
+    // expected period so the marks follow slow pitch drift
+    const int period = juce::roundToInt(periodSamples);
+    const int searchRadius = juce::jmax(1, period / 4);
+
+    auto peakIn = [source, numSamples](int start, int end)
+    {
+        start = juce::jmax(0, start);
+        end = juce::jmin(numSamples, end);
+
+        int best = start;
+        for (int i = start + 1; i < end; ++i)
+            if (source[i] > source[best])
+                best = i;
+
+        return best;
+    };
+
+    analysis.pitchMarks.reserve((size_t)(numSamples / period + 1));
+
+    for (int mark = peakIn(0, period); mark < numSamples; )
+    {
+        analysis.pitchMarks.push_back(mark);
+
+        const int expected = mark + period;
+
+        if (expected - searchRadius >= numSamples)
+            break;
+
+        mark = juce::jmax(mark + 1, peakIn(expected - searchRadius, expected + searchRadius + 1));
+    }
+
+    return analysis;
+}
+
+juce::int64 TimeStretchAnalysis::alignGrainStart(juce::int64 target, juce::int64 continuation) const
+{
+    if (pitchMarks.size() < 2)
+        return target;
+
+    // Last mark at or before position (the first mark for positions before it)
+    auto markBefore = [this](juce::int64 position) -> juce::int64
+    {
+        auto it = std::upper_bound(pitchMarks.begin(), pitchMarks.end(), position);
+        return it == pitchMarks.begin() ? *it : *(it - 1);
+    };
+
+    const juce::int64 offset = continuation - markBefore(continuation);
+    const juce::int64 aligned = markBefore(target) + offset;
+
+    // The continuation may sit in a longer period than the target's; never
+    // jump much more than a period (a quarter grain) away
+    const juce::int64 limit = grainLength / 4;
+    return juce::jlimit(target - limit, target + limit, aligned);
+}
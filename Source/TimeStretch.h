@@ -0,0 +1,38 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Load-time analysis for time-stretched (granular) playback.
+//
+// In that mode a voice plays overlapping Hann-windowed grains at 50%
+// overlap, each resampled to the note's pitch, while the point grains are
+// taken from advances at the sample's own speed. Duration then no longer
+// depends on pitch. To avoid the phasing of plain granular playback, each
+// new grain starts at the same offset from a pitch mark as the grain it
+// overlaps has reached (WSOLA-style alignment, done from precomputed
+// marks instead of a per-grain correlation search).
+//
+// Everything here is computed once per sound, so a voice's per-grain work
+// is one binary search.
+struct TimeStretchAnalysis
+{
+    int grainLength = 0;                // samples, even
+    int hop = 0;                        // grainLength / 2
+    std::vector<float> window;          // periodic Hann, sums to 1 at 50% overlap
+    std::vector<int> pitchMarks;        // ascending, about one per period
+
+    static constexpr int minGrainLength = 256;
+    static constexpr int maxGrainLength = 2048;
+
+    bool isValid() const { return grainLength > 0; }
+
+    // periodSamples is the sample's fundamental period; grains span about
+    // four periods
+    static TimeStretchAnalysis analyse(const float* source, int numSamples, double periodSamples);
+
+    // Where to start a grain aimed at target so that it continues the
+    // waveform the overlapping grain is reading at continuation. Stays
+    // within one period of target.
+    juce::int64 alignGrainStart(juce::int64 target, juce::int64 continuation) const;
+};
@@ -0,0 +1,193 @@
+#include "VariationPregenerator.h"
+
+//==============================================================================
+VariationPregenerator::VariationPregenerator()
+    : Thread("AI Variation Pregenerator")
+{
+    startThread();
+}
+
+VariationPregenerator::~VariationPregenerator()
+{
+    // The client polls for thread exit while waiting on the backend
+    stopThread(3000);
+}
+
+void VariationPregenerator::setLimits(const Limits& newLimits)
+{
+    const juce::ScopedLock sl(lock);
+    limits = newLimits;
+    notify();
+}
+
+void VariationPregenerator::start(const juce::String& prompt, float duration, double sampleRate,
+                                  bool compactSounds)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        currentPrompt = prompt;
+        currentDuration = duration;
+        currentSampleRate = sampleRate;
+        currentCompact = compactSounds;
+        ++epoch;
+        attempts = 0;
+        ready.clear();
+        readyBytes = 0;
+    }
+
+    notify();
+    sendChangeMessage();
+}
+
+void VariationPregenerator::clear()
+{
+    start({}, 0.0f, 0.0);
+}
+
+void VariationPregenerator::setPaused(bool shouldBePaused)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        paused = shouldBePaused;
+    }
+
+    notify();
+}
+
+bool VariationPregenerator::takeReady(Variation& variation)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (ready.empty())
+            return false;
+
+        variation = std::move(ready.front());
+        ready.pop_front();
+        readyBytes -= variation.sound->getSizeInBytes();
+    }
+
+    // Room for another one
+    notify();
+    sendChangeMessage();
+    return true;
+}
+
+int VariationPregenerator::getNumReady() const
+{
+    const juce::ScopedLock sl(lock);
+    return (int)ready.size();
+}
+
+size_t VariationPregenerator::getReadyBytes() const
+{
+    const juce::ScopedLock sl(lock);
+    return readyBytes;
+}
+
+//==============================================================================
+void VariationPregenerator::run()
+{
+    while (!threadShouldExit())
+    {
+        Job job;
+
+        if (!getNextJob(job))
+        {
+            wait(-1);
+            continue;
+        }
+
+        GenerationOptions options;
+        options.seed = job.seed;
+        options.lowPriority = true;
+
+        const auto result = client.generate(job.prompt, job.duration, job.sampleRate, options);
+
+        if (threadShouldExit())
+            break;
+
+        if (result.success)
+        {
+            if (auto sound = prepareSound(result, job.compact))
+                addReady(job, sound);
+            else
+                wait(errorBackoffMs);
+        }
+        else
+        {
+            // Preempted means a real request has the model; try again once
+            // it is likely done. Anything else waits longer.
+            DBG("Variation request failed: " + result.errorMessage);
+            wait(result.preempted ? preemptedBackoffMs : errorBackoffMs);
+        }
+    }
+}
+
+bool VariationPregenerator::getNextJob(Job& job)
+{
+    const juce::ScopedLock sl(lock);
+
+    if (paused || currentPrompt.isEmpty()
+        || (int)ready.size() >= limits.maxReady
+        || readyBytes >= limits.maxReadyBytes
+        || attempts >= limits.maxAttemptsPerPrompt)
+        return false;
+
+    ++attempts;
+
+    job.prompt = currentPrompt;
+    job.duration = currentDuration;
+    job.sampleRate = currentSampleRate;
+    job.compact = currentCompact;
+    job.seed = seedSource.nextInt(std::numeric_limits<int>::max());
+    job.epoch = epoch;
+    return true;
+}
+
+void VariationPregenerator::addReady(const Job& job, AISamplerSound::Ptr sound)
+{
+    const juce::ScopedLock sl(lock);
+
+    // Stale (the prompt changed while it generated) or over the memory cap
+    const size_t size = sound->getSizeInBytes();
+
+    if (job.epoch != epoch || (int)ready.size() >= limits.maxReady
+        || readyBytes + size > limits.maxReadyBytes)
+        return;
+
+    Variation variation;
+    variation.sound = sound;
+    variation.seed = job.seed;
+    variation.info = juce::String::formatted("Variation %d, Root: %d, Length: %.2fs",
+                                             job.seed, sound->getRootNote(),
+                                             sound->getLength() / sound->getSourceSampleRate());
+
+    ready.push_back(std::move(variation));
+    readyBytes += size;
+
+    sendChangeMessage();
+}
+
+AISamplerSound::Ptr VariationPregenerator::prepareSound(const GenerationResult& result, bool compact)
+{
+    // Decode and analyse now so taking a variation is only a pointer swap
+    juce::AudioBuffer<float> buffer;
+    double sampleRate = 0.0;
+
+    if (!AISamplerEngine::readMonoFile(juce::File(result.wavFilePath), buffer, sampleRate))
+        return nullptr;
+
+    auto sound = AISamplerEngine::createSoundFromAnalysis(buffer, sampleRate, result.analysis);
+
+    if (sound == nullptr)
+        sound = AISamplerEngine::createAnalysedSound(buffer, sampleRate);
+
+    // Compacted here rather than when taken, which also counts the
+    // compact size against the memory cap
+    if (sound != nullptr && compact)
+        sound->makeCompact();
+
+    return sound;
+}
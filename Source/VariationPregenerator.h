@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AIGenerator.h"
+#include "SamplerEngine.h"
+
+//==============================================================================
+// Generates new seeds of the current prompt while the backend is idle, so
+// "Another" can swap in a fresh variation instantly.
+//
+// Requests go out one at a time on their own connection, marked low
+// priority: the backend refuses them while busy and cancels a running one
+// as soon as a real request arrives. Finished clips are decoded and
+// analysed here, off the audio and message threads, and held as ready
+// sounds under a count and a memory cap. A change is broadcast whenever
+// the number of ready variations changes.
+class VariationPregenerator : public juce::ChangeBroadcaster,
+                              private juce::Thread
+{
+public:
+    struct Limits
+    {
+        int maxReady = 4;                               // variations held at once
+        size_t maxReadyBytes = 64 * 1024 * 1024;        // their sample memory
+        int maxAttemptsPerPrompt = 12;                  // total requests, including failures
+    };
+
+    struct Variation
+    {
+        AISamplerSound::Ptr sound;
+        int seed = -1;
+        juce::String info;
+    };
+
+    VariationPregenerator();
+    ~VariationPregenerator() override;
+
+    void setLimits(const Limits& newLimits);
+
+    // Starts speculating on a new prompt, dropping variations of the
+    // previous one, including a request already in flight. With
+    // compactSounds set, sounds are made compact as they are prepared.
+    void start(const juce::String& prompt, float duration, double sampleRate,
+               bool compactSounds = false);
+
+    // Drops everything and stops issuing requests
+    void clear();
+
+    // While paused no new request is issued; one in flight is left to the
+    // backend to cancel
+    void setPaused(bool shouldBePaused);
+
+    // Takes the oldest ready variation; false if none is ready yet
+    bool takeReady(Variation& variation);
+
+    int getNumReady() const;
+    size_t getReadyBytes() const;
+
+private:
+    struct Job
+    {
+        juce::String prompt;
+        float duration = 0.0f;
+        double sampleRate = 0.0;
+        bool compact = false;
+        int seed = -1;
+        int epoch = 0;
+    };
+
+    static constexpr int preemptedBackoffMs = 2000;
+    static constexpr int errorBackoffMs = 10000;
+
+    AIGenerator client;
+
+    mutable juce::CriticalSection lock;
+    Limits limits;
+    juce::String currentPrompt;
+    float currentDuration = 0.0f;
+    double currentSampleRate = 0.0;
+    bool currentCompact = false;
+    int epoch = 0;                      // bumped whenever the prompt changes
+    int attempts = 0;
+    bool paused = false;
+    juce::Random seedSource;
+
+    std::deque<Variation> ready;
+    size_t readyBytes = 0;
+
+    void run() override;
+    bool getNextJob(Job& job);
+    void addReady(const Job& job, AISamplerSound::Ptr sound);
+    static AISamplerSound::Ptr prepareSound(const GenerationResult& result, bool compact);
+};
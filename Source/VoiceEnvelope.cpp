@@ -0,0 +1,126 @@
+#include "VoiceEnvelope.h"
+
+VoiceEnvelope::VoiceEnvelope()
+{
+    enterStage(Stage::idle);
+}
+
+void VoiceEnvelope::setParameters(const juce::ADSR::Parameters& newParameters)
+{
+    parameters = newParameters;
+}
+
+void VoiceEnvelope::setSampleRate(double newSampleRate)
+{
+    jassert(newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+}
+
+void VoiceEnvelope::noteOn()
+{
+    enterStage(Stage::attack);
+}
+
+void VoiceEnvelope::noteOff()
+{
+    if (stage != Stage::idle)
+        enterStage(Stage::release);
+}
+
+void VoiceEnvelope::reset()
+{
+    enterStage(Stage::idle);
+}
+
+void VoiceEnvelope::fadeOut(double seconds)
+{
+    if (stage == Stage::idle
+        || (stage == Stage::release && samplesLeft <= (int)std::lround(seconds * sampleRate)))
+        return;
+
+    stage = Stage::release;
+    rampTo(0.0f, seconds, Stage::idle);
+}
+
+void VoiceEnvelope::advance(int numSamples)
+{
+    jassert(numSamples <= samplesLeft);
+
+    if (stage == Stage::idle || stage == Stage::sustain)
+        return;
+
+    samplesLeft -= numSamples;
+
+    if (samplesLeft > 0)
+    {
+        level += slope * (float)numSamples;
+        return;
+    }
+
+    // Land exactly on the target so rounding never accumulates across stages
+    level = target;
+
+    if (stage == Stage::attack)
+        enterStage(Stage::decay);
+    else if (stage == Stage::decay)
+        enterStage(Stage::sustain);
+    else
+        enterStage(Stage::idle);
+}
+
+float VoiceEnvelope::getNextSample()
+{
+    const float current = level;
+    advance(1);
+    return current;
+}
+
+void VoiceEnvelope::enterStage(Stage newStage)
+{
+    stage = newStage;
+
+    switch (newStage)
+    {
+        case Stage::idle:
+            level = 0.0f;
+            slope = 0.0f;
+            samplesLeft = sustainSamples;
+            break;
+
+        case Stage::attack:
+            // Same rate as a full attack, so retriggering from a non-zero
+            // level reaches the peak sooner
+            rampTo(1.0f, parameters.attack * (1.0f - level), Stage::decay);
+            break;
+
+        case Stage::decay:
+            rampTo(parameters.sustain, parameters.decay, Stage::sustain);
+            break;
+
+        case Stage::sustain:
+            level = parameters.sustain;
+            slope = 0.0f;
+            samplesLeft = sustainSamples;
+            break;
+
+        case Stage::release:
+            rampTo(0.0f, parameters.release, Stage::idle);
+            break;
+    }
+}
+
+void VoiceEnvelope::rampTo(float targetLevel, double seconds, Stage nextStage)
+{
+    const int numSamples = (int)std::lround(seconds * sampleRate);
+
+    if (numSamples <= 0)
+    {
+        level = targetLevel;
+        enterStage(nextStage);
+        return;
+    }
+
+    target = targetLevel;
+    slope = (targetLevel - level) / (float)numSamples;
+    samplesLeft = numSamples;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Linear ADSR with the same shape as juce::ADSR, but which exposes its stage,
+// per-sample slope and the number of samples left in the stage. The voice
+// renderer uses that to process whole envelope segments at once instead of
+// stepping the envelope one sample at a time.
+class VoiceEnvelope
+{
+public:
+    enum class Stage { idle, attack, decay, sustain, release };
+
+    VoiceEnvelope();
+
+    void setParameters(const juce::ADSR::Parameters& newParameters);
+    const juce::ADSR::Parameters& getParameters() const { return parameters; }
+    void setSampleRate(double newSampleRate);
+
+    void noteOn();
+    void noteOff();
+    void reset();
+
+    // Releases to silence within seconds, unless it would get there sooner
+    void fadeOut(double seconds);
+
+    bool isActive() const { return stage != Stage::idle; }
+    Stage getStage() const { return stage; }
+    float getLevel() const { return level; }
+
+    // Per-sample change of the level within the current stage
+    float getSlope() const { return slope; }
+
+    // Samples until the stage ends; a large number while sustaining
+    int getSamplesUntilStageEnd() const { return samplesLeft; }
+
+    // Moves numSamples forward (at most getSamplesUntilStageEnd())
+    void advance(int numSamples);
+
+    // Moves one sample forward and returns the level to apply to it
+    float getNextSample();
+
+private:
+    juce::ADSR::Parameters parameters;
+    double sampleRate = 44100.0;
+
+    Stage stage = Stage::idle;
+    float level = 0.0f;
+    float slope = 0.0f;
+    float target = 0.0f;
+    int samplesLeft = 0;
+
+    static constexpr int sustainSamples = 1 << 30;
+
+    void enterStage(Stage newStage);
+    void rampTo(float targetLevel, double seconds, Stage nextStage);
+};
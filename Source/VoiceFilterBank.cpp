@@ -0,0 +1,205 @@
+#include "VoiceFilterBank.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <xmmintrin.h>
+ #define VOICE_FILTER_SIMD 1
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+ #define VOICE_FILTER_SIMD 1
+#else
+ #define VOICE_FILTER_SIMD 0
+#endif
+
+namespace
+{
+    inline float add(float a, float b) noexcept { return a + b; }
+    inline float sub(float a, float b) noexcept { return a - b; }
+    inline float mul(float a, float b) noexcept { return a * b; }
+
+    struct ScalarCoefficients { float a1, a2, a3, m0, m1, m2; };
+
+#if JUCE_USE_SSE_INTRINSICS
+    using Lanes = __m128;
+
+    struct LaneCoefficients { Lanes a1, a2, a3, m0, m1, m2; };
+
+    inline Lanes load(const float* p) noexcept { return _mm_loadu_ps(p); }
+    inline void store(float* p, Lanes v) noexcept { _mm_storeu_ps(p, v); }
+    inline Lanes add(Lanes a, Lanes b) noexcept { return _mm_add_ps(a, b); }
+    inline Lanes sub(Lanes a, Lanes b) noexcept { return _mm_sub_ps(a, b); }
+    inline Lanes mul(Lanes a, Lanes b) noexcept { return _mm_mul_ps(a, b); }
+
+    inline void transpose(Lanes& r0, Lanes& r1, Lanes& r2, Lanes& r3) noexcept
+    {
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    }
+#elif JUCE_USE_ARM_NEON
+    using Lanes = float32x4_t;
+
+    struct LaneCoefficients { Lanes a1, a2, a3, m0, m1, m2; };
+
+    inline Lanes load(const float* p) noexcept { return vld1q_f32(p); }
+    inline void store(float* p, Lanes v) noexcept { vst1q_f32(p, v); }
+    inline Lanes add(Lanes a, Lanes b) noexcept { return vaddq_f32(a, b); }
+    inline Lanes sub(Lanes a, Lanes b) noexcept { return vsubq_f32(a, b); }
+    inline Lanes mul(Lanes a, Lanes b) noexcept { return vmulq_f32(a, b); }
+
+    inline void transpose(Lanes& r0, Lanes& r1, Lanes& r2, Lanes& r3) noexcept
+    {
+        const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+        const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+        r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+        r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+        r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+        r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+    }
+#endif
+
+    // One sample through the filter; the same code for a float and for a
+    // vector of lanes
+    template <typename Value, typename Coefficients>
+    inline Value tick(Value x, Value& s1, Value& s2, const Coefficients& c) noexcept
+    {
+        const Value v3 = sub(x, s2);
+        const Value v1 = add(mul(c.a1, s1), mul(c.a2, v3));
+        const Value v2 = add(s2, add(mul(c.a2, s1), mul(c.a3, v3)));
+
+        s1 = sub(add(v1, v1), s1);
+        s2 = sub(add(v2, v2), s2);
+
+        return add(mul(c.m0, x), add(mul(c.m1, v1), mul(c.m2, v2)));
+    }
+}
+
+//==============================================================================
+void VoiceFilterBank::prepare(int numVoices)
+{
+    numLanes = (juce::jmax(0, numVoices) + laneWidth - 1) / laneWidth * laneWidth;
+
+    for (auto* values : { &s1, &s2, &a2, &a3, &m0, &m1, &m2 })
+        values->assign((size_t)numLanes, 0.0f);
+
+    a1.assign((size_t)numLanes, 1.0f);
+}
+
+void VoiceFilterBank::resetLane(int lane)
+{
+    s1[(size_t)lane] = 0.0f;
+    s2[(size_t)lane] = 0.0f;
+}
+
+void VoiceFilterBank::setCoefficients(int lane, VoiceFilterSettings::Type type, float cutoffHz, float resonance,
+                                      double sampleRate)
+{
+    const double cutoff = juce::jlimit(20.0, 0.45 * sampleRate, (double)cutoffHz);
+    const float g = (float)std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate);
+    const float k = 2.0f - 1.96f * juce::jlimit(0.0f, 1.0f, resonance);
+
+    const auto i = (size_t)lane;
+    a1[i] = 1.0f / (1.0f + g * (g + k));
+    a2[i] = g * a1[i];
+    a3[i] = g * a2[i];
+
+    switch (type)
+    {
+        case VoiceFilterSettings::Type::lowPass:   m0[i] = 0.0f; m1[i] = 0.0f; m2[i] = 1.0f;  break;
+        case VoiceFilterSettings::Type::bandPass:  m0[i] = 0.0f; m1[i] = k;    m2[i] = 0.0f;  break;   // unity peak
+        case VoiceFilterSettings::Type::highPass:  m0[i] = 1.0f; m1[i] = -k;   m2[i] = -1.0f; break;
+    }
+}
+
+void VoiceFilterBank::process(const float* const* inputs, float* mix, int numSamples)
+{
+    jassert(numSamples <= controlInterval);
+
+#if VOICE_FILTER_SIMD
+    static_assert(laneWidth == 4, "one SSE or NEON register of lanes");
+
+    for (int first = 0; first < numLanes; first += laneWidth)
+    {
+        // Silent lanes read zeros and have their output mixed out, so they
+        // add nothing, as in processScalar
+        const float* in[laneWidth];
+        alignas(16) float outputMix[3][laneWidth];
+        bool anySounding = false;
+
+        for (int j = 0; j < laneWidth; ++j)
+        {
+            const auto lane = (size_t)(first + j);
+            const bool sounding = inputs[lane] != nullptr;
+
+            in[j] = sounding ? inputs[lane] : silence.data();
+            outputMix[0][j] = sounding ? m0[lane] : 0.0f;
+            outputMix[1][j] = sounding ? m1[lane] : 0.0f;
+            outputMix[2][j] = sounding ? m2[lane] : 0.0f;
+            anySounding = anySounding || sounding;
+        }
+
+        if (!anySounding)
+            continue;
+
+        const LaneCoefficients c { load(a1.data() + first), load(a2.data() + first), load(a3.data() + first),
+                                  load(outputMix[0]), load(outputMix[1]), load(outputMix[2]) };
+
+        Lanes state1 = load(s1.data() + first);
+        Lanes state2 = load(s2.data() + first);
+        int n = 0;
+
+        // Four samples of four lanes at a time: transposed so each vector
+        // holds one sample of every lane, filtered in order, then transposed
+        // back so the lanes sum to four mix samples with plain adds
+        for (; n + 4 <= numSamples; n += 4)
+        {
+            Lanes x0 = load(in[0] + n);
+            Lanes x1 = load(in[1] + n);
+            Lanes x2 = load(in[2] + n);
+            Lanes x3 = load(in[3] + n);
+
+            transpose(x0, x1, x2, x3);
+
+            x0 = tick(x0, state1, state2, c);
+            x1 = tick(x1, state1, state2, c);
+            x2 = tick(x2, state1, state2, c);
+            x3 = tick(x3, state1, state2, c);
+
+            transpose(x0, x1, x2, x3);
+
+            store(mix + n, add(load(mix + n), add(add(x0, x1), add(x2, x3))));
+        }
+
+        for (; n < numSamples; ++n)
+        {
+            alignas(16) float x[laneWidth] = { in[0][n], in[1][n], in[2][n], in[3][n] };
+            store(x, tick(load(x), state1, state2, c));
+            mix[n] += (x[0] + x[1]) + (x[2] + x[3]);
+        }
+
+        store(s1.data() + first, state1);
+        store(s2.data() + first, state2);
+    }
+#else
+    processScalar(inputs, mix, numSamples);
+#endif
+}
+
+void VoiceFilterBank::processScalar(const float* const* inputs, float* mix, int numSamples)
+{
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        const float* input = inputs[lane];
+
+        if (input == nullptr)
+            continue;
+
+        const auto i = (size_t)lane;
+        const ScalarCoefficients c { a1[i], a2[i], a3[i], m0[i], m1[i], m2[i] };
+        float state1 = s1[i];
+        float state2 = s2[i];
+
+        for (int n = 0; n < numSamples; ++n)
+            mix[n] += tick(input[n], state1, state2, c);
+
+        s1[i] = state1;
+        s2[i] = state2;
+    }
+}
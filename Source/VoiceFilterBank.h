@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Per-voice filter, shaped by its own envelope and by the note, velocity and
+// timbre (CC74). Offsets are in semitones from cutoffHz.
+struct VoiceFilterSettings
+{
+    enum class Type { lowPass, bandPass, highPass };
+
+    bool enabled = false;
+    Type type = Type::lowPass;
+    float cutoffHz = 1200.0f;           // at middle C, full velocity, envelope closed
+    float resonance = 0.2f;             // 0..1, rings but never self-oscillates
+
+    float envelopeAmount = 36.0f;       // at the envelope's peak
+    float keyTracking = 0.5f;           // 1 follows the note exactly
+    float velocityAmount = 24.0f;       // how far a note at velocity 0 closes it
+    float timbreAmount = 24.0f;         // either way from CC74's centre
+
+    juce::ADSR::Parameters envelope { 0.005f, 0.4f, 0.3f, 0.4f };
+};
+
+//==============================================================================
+// State-variable filters (Simper's trapezoidal SVF) for every voice of an
+// engine, kept as structure-of-arrays: one array per state variable and
+// coefficient, one lane per voice.
+//
+// Lanes are processed laneWidth at a time with SSE or NEON, so the cost per
+// voice stays flat as polyphony grows; groups whose lanes are all silent are
+// skipped. Coefficients are set per lane once per control block, and the
+// filtered voices are summed straight into a mono mix.
+class VoiceFilterBank
+{
+public:
+    static constexpr int laneWidth = 4;
+
+    // Coefficients are updated this often; also the longest block process takes
+    static constexpr int controlInterval = 32;
+
+    void prepare(int numVoices);
+    int getNumLanes() const { return numLanes; }
+
+    // Clears a lane's state, for a new note
+    void resetLane(int lane);
+
+    void setCoefficients(int lane, VoiceFilterSettings::Type type, float cutoffHz, float resonance,
+                         double sampleRate);
+
+    // Filters inputs[lane] (one per lane, nullptr when silent) and adds
+    // every lane to mix. numSamples is at most controlInterval.
+    void process(const float* const* inputs, float* mix, int numSamples);
+
+    // One lane after another with plain float code; the fallback without
+    // SIMD, and the baseline the benchmark compares against
+    void processScalar(const float* const* inputs, float* mix, int numSamples);
+
+private:
+    int numLanes = 0;                   // padded to a multiple of laneWidth
+
+    // Integrator states
+    std::vector<float> s1, s2;
+
+    // a1..a3 solve the implicit step; m0..m2 mix input, band and low
+    // into the chosen response
+    std::vector<float> a1, a2, a3;
+    std::vector<float> m0, m1, m2;
+
+    std::array<float, controlInterval> silence {};
+};
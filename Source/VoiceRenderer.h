@@ -0,0 +1,183 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Resampling quality for sample playback, cheapest first
+enum class InterpolationMode
+{
+    DropSample,     // previous sample, no interpolation
+    Linear,         // 2-point
+    Hermite         // 4-point, 3rd order
+};
+
+//==============================================================================
+// Inner loops for AISamplerVoice.
+//
+// The voice cuts each block into spans in which nothing can change shape:
+// no loop wrap, no end of sample, no envelope stage change, and every
+// interpolation tap inside the source. Each span is rendered by a kernel
+// specialised at compile time on interpolation mode, output channel count
+// and whether gain and pitch ramp, so the per-sample loop has no branches.
+struct VoiceRenderer
+{
+    // 32.32 fixed-point read position. Integer increments are exact, so
+    // long loops never drift the way an accumulated double does.
+    static constexpr int phaseFractionBits = 32;
+    static constexpr juce::uint64 phaseOne = (juce::uint64)1 << phaseFractionBits;
+
+    static juce::uint64 toPhaseIncrement(double ratio) noexcept
+    {
+        return (juce::uint64)std::llround(ratio * (double)phaseOne);
+    }
+
+    static juce::int64 phaseIndex(juce::uint64 phase) noexcept
+    {
+        return (juce::int64)(phase >> phaseFractionBits);
+    }
+
+    static float phaseFraction(juce::uint64 phase) noexcept
+    {
+        return (float)(juce::uint32)phase * (1.0f / (float)phaseOne);
+    }
+
+    // Source samples read around the integer position: p[-1] .. p[2]
+    static constexpr int tapsBefore = 1;
+    static constexpr int tapsAfter = 2;
+    static constexpr int numTaps = tapsBefore + 1 + tapsAfter;
+
+    struct Span
+    {
+        const float* source = nullptr;
+        float* const* outputs = nullptr;
+        int numOutputChannels = 0;
+        int outputStart = 0;
+        juce::uint64 phase = 0;
+        juce::uint64 increment = 0;
+        juce::int64 incrementDelta = 0;     // per-sample change of increment (pitch glides)
+        float gain = 0.0f;
+        float gainIncrement = 0.0f;
+    };
+
+    using Kernel = void (*)(Span&, int numSamples);
+
+    // Kernel for this combination; channel counts other than 1 and 2 use a
+    // generic channel loop. A ramping kernel ramps both gain and increment.
+    static Kernel getKernel(InterpolationMode mode, int numOutputChannels, bool ramping) noexcept
+    {
+        static constexpr Kernel kernels[3][3][2] =
+        {
+            { { renderSpan<InterpolationMode::DropSample, 0, false>, renderSpan<InterpolationMode::DropSample, 0, true> },
+              { renderSpan<InterpolationMode::DropSample, 1, false>, renderSpan<InterpolationMode::DropSample, 1, true> },
+              { renderSpan<InterpolationMode::DropSample, 2, false>, renderSpan<InterpolationMode::DropSample, 2, true> } },
+            { { renderSpan<InterpolationMode::Linear, 0, false>,     renderSpan<InterpolationMode::Linear, 0, true> },
+              { renderSpan<InterpolationMode::Linear, 1, false>,     renderSpan<InterpolationMode::Linear, 1, true> },
+              { renderSpan<InterpolationMode::Linear, 2, false>,     renderSpan<InterpolationMode::Linear, 2, true> } },
+            { { renderSpan<InterpolationMode::Hermite, 0, false>,    renderSpan<InterpolationMode::Hermite, 0, true> },
+              { renderSpan<InterpolationMode::Hermite, 1, false>,    renderSpan<InterpolationMode::Hermite, 1, true> },
+              { renderSpan<InterpolationMode::Hermite, 2, false>,    renderSpan<InterpolationMode::Hermite, 2, true> } }
+        };
+
+        const int channelIndex = (numOutputChannels == 1 || numOutputChannels == 2) ? numOutputChannels : 0;
+        return kernels[(int)mode][channelIndex][ramping ? 1 : 0];
+    }
+
+    // Taps are read as source[index + offset] rather than through a moved
+    // pointer, which is the form compilers turn into gathers
+    template <InterpolationMode mode>
+    static forcedinline float interpolate(const float* source, int index, float frac) noexcept
+    {
+        if constexpr (mode == InterpolationMode::DropSample)
+        {
+            juce::ignoreUnused(frac);
+            return source[index];
+        }
+        else if constexpr (mode == InterpolationMode::Linear)
+        {
+            const float p0 = source[index];
+            return p0 + frac * (source[index + 1] - p0);
+        }
+        else
+        {
+            const float pm1 = source[index - 1];
+            const float p0 = source[index];
+            const float p1 = source[index + 1];
+            const float p2 = source[index + 2];
+            const float c1 = 0.5f * (p1 - pm1);
+            const float c2 = pm1 - 2.5f * p0 + 2.0f * p1 - 0.5f * p2;
+            const float c3 = 0.5f * (p2 - pm1) + 1.5f * (p0 - p1);
+            return ((c3 * frac + c2) * frac + c1) * frac + p0;
+        }
+    }
+
+    // Per-sample dispatch, for the few samples next to a span boundary;
+    // p points at the sample at the integer read position
+    static float interpolate(InterpolationMode mode, const float* p, float frac) noexcept
+    {
+        switch (mode)
+        {
+            case InterpolationMode::DropSample: return interpolate<InterpolationMode::DropSample>(p, 0, frac);
+            case InterpolationMode::Linear:     return interpolate<InterpolationMode::Linear>(p, 0, frac);
+            case InterpolationMode::Hermite:    return interpolate<InterpolationMode::Hermite>(p, 0, frac);
+        }
+
+        return p[0];
+    }
+
+    // Spans are rendered a chunk at a time in two passes. The first walks
+    // the phase recurrence (a pitch glide changes the increment every
+    // sample) and stores each read position; the second interpolates from
+    // those into a local buffer, taking the gain ramp as gain + i * step,
+    // so nothing is carried between samples and it vectorizes whether or
+    // not the span ramps. The buffer is then added to each output.
+    static constexpr int chunkLength = 64;
+
+    template <InterpolationMode mode, int channels, bool ramping>
+    static void renderSpan(Span& span, int numSamples) noexcept
+    {
+        const float* const source = span.source;
+        const juce::uint64 incrementDelta = (juce::uint64)span.incrementDelta;
+        const float gainIncrement = span.gainIncrement;
+        juce::uint64 increment = span.increment;
+        juce::uint64 phase = span.phase;
+        float gain = span.gain;
+
+        int indices[chunkLength];
+        float fractions[chunkLength];
+        float rendered[chunkLength];
+
+        for (int chunkStart = 0; chunkStart < numSamples; chunkStart += chunkLength)
+        {
+            const int length = juce::jmin(chunkLength, numSamples - chunkStart);
+
+            for (int i = 0; i < length; ++i)
+            {
+                indices[i] = (int)phaseIndex(phase);
+                fractions[i] = phaseFraction(phase);
+                phase += increment;
+
+                if constexpr (ramping)
+                    increment += incrementDelta;    // wraps like a signed add
+            }
+
+            for (int i = 0; i < length; ++i)
+            {
+                const float sampleGain = ramping ? gain + (float)i * gainIncrement : gain;
+                rendered[i] = interpolate<mode>(source, indices[i], fractions[i]) * sampleGain;
+            }
+
+            if constexpr (ramping)
+                gain += (float)length * gainIncrement;
+
+            const int numOutputs = channels != 0 ? channels : span.numOutputChannels;
+
+            for (int ch = 0; ch < numOutputs; ++ch)
+                juce::FloatVectorOperations::add(span.outputs[ch] + span.outputStart + chunkStart, rendered, length);
+        }
+
+        span.phase = phase;
+        span.increment = increment;
+        span.gain = gain;
+        span.outputStart += numSamples;
+    }
+};
@@ -0,0 +1,83 @@
+#include "WaveformPeaks.h"
+
+WaveformPeaks WaveformPeaks::build(const float* source, int numSamples)
+{
+    WaveformPeaks peaks;
+
+    if (source == nullptr || numSamples <= 0)
+        return peaks;
+
+    peaks.numSamples = numSamples;
+
+    // Level 0 straight from the samples
+    std::vector<juce::Range<float>> level((size_t)((numSamples + baseBucketSize - 1) / baseBucketSize));
+
+    for (size_t i = 0; i < level.size(); ++i)
+    {
+        const int start = (int)i * baseBucketSize;
+        level[i] = juce::FloatVectorOperations::findMinAndMax(source + start, juce::jmin(baseBucketSize, numSamples - start));
+    }
+
+    peaks.levels.push_back(std::move(level));
+
+    // Each further level from the one below
+    while (peaks.levels.back().size() > 1)
+    {
+        const auto& finer = peaks.levels.back();
+        std::vector<juce::Range<float>> coarser((finer.size() + levelFactor - 1) / levelFactor);
+
+        for (size_t i = 0; i < coarser.size(); ++i)
+        {
+            auto range = finer[i * levelFactor];
+
+            for (size_t j = i * levelFactor + 1; j < juce::jmin(finer.size(), (i + 1) * levelFactor); ++j)
+                range = range.getUnionWith(finer[j]);
+
+            coarser[i] = range;
+        }
+
+        peaks.levels.push_back(std::move(coarser));
+    }
+
+    return peaks;
+}
+
+juce::Range<float> WaveformPeaks::getRange(int startSample, int endSample) const
+{
+    startSample = juce::jmax(0, startSample);
+    endSample = juce::jmin(numSamples, endSample);
+
+    if (!isValid() || endSample <= startSample)
+        return {};
+
+    // Coarsest level whose buckets are no longer than the span
+    size_t levelIndex = 0;
+    int bucketSize = baseBucketSize;
+
+    while (levelIndex + 1 < levels.size() && bucketSize * levelFactor <= endSample - startSample)
+    {
+        ++levelIndex;
+        bucketSize *= levelFactor;
+    }
+
+    const auto& level = levels[levelIndex];
+    const size_t first = (size_t)(startSample / bucketSize);
+    const size_t last = juce::jmin(level.size() - 1, (size_t)((endSample - 1) / bucketSize));
+
+    auto range = level[first];
+
+    for (size_t i = first + 1; i <= last; ++i)
+        range = range.getUnionWith(level[i]);
+
+    return range;
+}
+
+size_t WaveformPeaks::getSizeInBytes() const
+{
+    size_t bytes = 0;
+
+    for (auto& level : levels)
+        bytes += level.size() * sizeof(juce::Range<float>);
+
+    return bytes;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Min/max overview of a sample at several resolutions, for drawing.
+//
+// Level 0 holds one range per baseBucketSize samples and each further level
+// merges four buckets of the one below, down to a single bucket. Any span
+// of the sample is then answered from a handful of buckets of the coarsest
+// level that still resolves it, so drawing costs one lookup per pixel
+// column whatever the sample length or zoom.
+//
+// Built once per sound, next to its time-stretch analysis.
+struct WaveformPeaks
+{
+    static constexpr int baseBucketSize = 64;
+    static constexpr int levelFactor = 4;
+
+    int numSamples = 0;
+    std::vector<std::vector<juce::Range<float>>> levels;   // finest first
+
+    bool isValid() const { return numSamples > 0 && !levels.empty(); }
+
+    static WaveformPeaks build(const float* source, int numSamples);
+
+    // Lowest and highest sample in [startSample, endSample), rounded out
+    // to bucket edges
+    juce::Range<float> getRange(int startSample, int endSample) const;
+
+    size_t getSizeInBytes() const;
+};
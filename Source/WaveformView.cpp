@@ -0,0 +1,123 @@
+#include "WaveformView.h"
+
+WaveformView::WaveformView()
+{
+    setOpaque(true);
+}
+
+void WaveformView::setSound(AISamplerSound::Ptr newSound)
+{
+    if (newSound == sound)
+        return;
+
+    sound = newSound;
+    waveformImage = {};
+    numPlayheads = 0;
+    repaint();
+}
+
+void WaveformView::setPlayPositions(const int* positions, int numPositions)
+{
+    numPositions = juce::jmin(numPositions, maxPlayheads);
+
+    std::array<int, maxPlayheads> newX;
+
+    for (int i = 0; i < numPositions; ++i)
+        newX[(size_t)i] = sampleToX(positions[i]);
+
+    if (numPositions == numPlayheads && std::equal(newX.begin(), newX.begin() + numPositions, playheadX.begin()))
+        return;
+
+    for (int i = 0; i < numPlayheads; ++i)
+        repaintColumn(playheadX[(size_t)i]);
+
+    for (int i = 0; i < numPositions; ++i)
+        repaintColumn(newX[(size_t)i]);
+
+    playheadX = newX;
+    numPlayheads = numPositions;
+}
+
+void WaveformView::paint(juce::Graphics& g)
+{
+    if (sound == nullptr || !sound->getWaveformPeaks().isValid())
+    {
+        g.fillAll(juce::Colour(0xff2a2a2a));
+        g.setColour(juce::Colours::grey);
+        g.setFont(14.0f);
+        g.drawText("No sample loaded", getLocalBounds(), juce::Justification::centred);
+        return;
+    }
+
+    if (!waveformImage.isValid())
+        renderWaveformImage();
+
+    g.drawImageAt(waveformImage, 0, 0);
+
+    // Loop region, unless the loop is simply the whole sample
+    const int loopStart = sound->getLoopStart();
+    const int loopEnd = sound->getLoopEnd();
+
+    if (loopEnd > loopStart && (loopStart > 0 || loopEnd < sound->getLength()))
+    {
+        const int startX = sampleToX(loopStart);
+        const int endX = sampleToX(loopEnd);
+
+        g.setColour(loopColour);
+        g.fillRect(startX, 0, juce::jmax(1, endX - startX), getHeight());
+
+        g.setColour(waveformColour);
+        g.drawVerticalLine(startX, 0.0f, (float)getHeight());
+        g.drawVerticalLine(juce::jmax(startX, endX - 1), 0.0f, (float)getHeight());
+    }
+
+    g.setColour(playheadColour);
+
+    for (int i = 0; i < numPlayheads; ++i)
+        g.drawVerticalLine(playheadX[(size_t)i], 0.0f, (float)getHeight());
+}
+
+void WaveformView::resized()
+{
+    waveformImage = {};
+}
+
+void WaveformView::renderWaveformImage()
+{
+    const int width = juce::jmax(1, getWidth());
+    const int height = juce::jmax(1, getHeight());
+
+    waveformImage = juce::Image(juce::Image::RGB, width, height, false);
+
+    juce::Graphics g(waveformImage);
+    g.fillAll(juce::Colour(0xff2a2a2a));
+
+    const auto& peaks = sound->getWaveformPeaks();
+    const float centre = (float)height * 0.5f;
+
+    g.setColour(waveformColour);
+
+    // One peak lookup per column; at least one pixel tall so silence still
+    // shows as a line
+    for (int x = 0; x < width; ++x)
+    {
+        const int start = (int)((juce::int64)x * peaks.numSamples / width);
+        const int end = (int)((juce::int64)(x + 1) * peaks.numSamples / width);
+        const auto range = peaks.getRange(start, juce::jmax(start + 1, end));
+
+        g.drawVerticalLine(x, centre - range.getEnd() * centre, centre - range.getStart() * centre + 1.0f);
+    }
+}
+
+int WaveformView::sampleToX(int sample) const
+{
+    if (sound == nullptr || sound->getLength() <= 0)
+        return 0;
+
+    return juce::jlimit(0, juce::jmax(0, getWidth() - 1), (int)((juce::int64)sample * getWidth() / sound->getLength()));
+}
+
+void WaveformView::repaintColumn(int x)
+{
+    repaint(x - 1, 0, 3, getHeight());
+}
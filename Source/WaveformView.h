@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerEngine.h"
+
+//==============================================================================
+// Overview of the loaded sample with its loop region and a playhead per
+// sounding voice.
+//
+// The waveform is drawn from the sound's peak cache into an image once per
+// sound and size; repaints for moving playheads only blit that image and
+// draw the overlays, and only the columns a playhead left or entered are
+// repainted.
+class WaveformView : public juce::Component
+{
+public:
+    WaveformView();
+
+    // Shows a new sound; does nothing if it is already shown
+    void setSound(AISamplerSound::Ptr newSound);
+    const AISamplerSound* getSound() const { return sound.get(); }
+
+    // Source positions of the playheads to draw; an empty list hides them
+    void setPlayPositions(const int* positions, int numPositions);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    static constexpr int maxPlayheads = 16;
+
+private:
+    AISamplerSound::Ptr sound;
+    juce::Image waveformImage;          // rebuilt lazily when invalid
+
+    std::array<int, maxPlayheads> playheadX;
+    int numPlayheads = 0;
+
+    juce::Colour waveformColour = juce::Colour(0xff4CAF50);
+    juce::Colour loopColour = juce::Colour(0x334CAF50);
+    juce::Colour playheadColour = juce::Colours::white;
+
+    void renderWaveformImage();
+    int sampleToX(int sample) const;
+    void repaintColumn(int x);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformView)
+};
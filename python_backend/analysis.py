@@ -0,0 +1,144 @@
+"""
+Sample analysis for generated clips
+
+Runs the same trim -> normalize -> pitch -> loop pipeline as the plugin's
+AISamplerEngine, vectorised with numpy, so the plugin can load a clip
+straight from the returned metadata instead of analysing it again.
+"""
+
+import numpy as np
+
+SILENCE_THRESHOLD = 0.001   # -60 dB roughly
+TARGET_PEAK_DB = -0.5
+MIN_PERIOD = 20             # lag range in samples, as in PitchDetector
+MAX_PERIOD = 2000
+PITCH_WINDOW = 8192
+MIN_CORRELATION = 0.3
+PEAK_THRESHOLD = 0.9        # of the best correlation, as in PitchDetector
+LOOP_SEARCH = 1000
+
+def to_mono(audio):
+    """[channels, samples] or [samples] to a float32 [samples] array"""
+    audio = np.asarray(audio, dtype=np.float32)
+    return audio.mean(axis=0) if audio.ndim > 1 else audio
+
+def trim_silence(audio, threshold=SILENCE_THRESHOLD):
+    """Drop leading and trailing samples below threshold"""
+    loud = np.flatnonzero(np.abs(audio) > threshold)
+
+    if len(loud) < 2:
+        return audio
+
+    return audio[loud[0]:loud[-1] + 1]
+
+def normalize(audio, target_db=TARGET_PEAK_DB):
+    """Scale so the peak sits at target_db; returns (audio, peak_db)"""
+    peak = float(np.max(np.abs(audio))) if len(audio) else 0.0
+
+    if peak <= 0.0:
+        return audio, None
+
+    return audio * np.float32(10.0 ** (target_db / 20.0) / peak), target_db
+
+def detect_pitch(audio, sample_rate):
+    """
+    Normalised autocorrelation over the first PITCH_WINDOW samples
+
+    All lags are computed at once with an FFT; the per-lag energy terms
+    come from cumulative sums. Every multiple of the period correlates
+    almost as well as the period itself, so the first local peak within
+    PEAK_THRESHOLD of the best is taken, refined by parabolic interpolation.
+    Returns the frequency in Hz, or None.
+    """
+    if len(audio) < MAX_PERIOD * 2:
+        return None
+
+    x = audio[:PITCH_WINDOW].astype(np.float64)
+    n = len(x)
+    max_lag = min(MAX_PERIOD, n // 2)
+
+    spectrum = np.fft.rfft(x, 2 * n)
+    correlation = np.fft.irfft(spectrum * np.conj(spectrum), 2 * n)[:max_lag]
+
+    # Energy of x[:n - lag] and of x[lag:]
+    energy = np.concatenate(([0.0], np.cumsum(x * x)))
+    lags = np.arange(max_lag)
+    norm = np.sqrt(energy[n - lags] * (energy[n] - energy[lags]))
+
+    with np.errstate(divide='ignore', invalid='ignore'):
+        normalised = np.where(norm > 0.0, correlation / norm, 0.0)
+
+    if max_lag <= MIN_PERIOD:
+        return None
+
+    best = float(np.max(normalised[MIN_PERIOD:max_lag]))
+
+    if best < MIN_CORRELATION:
+        return None
+
+    inner = normalised[MIN_PERIOD + 1:max_lag - 1]
+    peaks = np.flatnonzero((inner >= PEAK_THRESHOLD * best)
+                           & (inner >= normalised[MIN_PERIOD:max_lag - 2])
+                           & (inner >= normalised[MIN_PERIOD + 2:max_lag]))
+
+    if len(peaks) == 0:
+        return None
+
+    lag = MIN_PERIOD + 1 + int(peaks[0])
+
+    # Parabolic interpolation between lags for sub-sample accuracy
+    before, centre, after = normalised[lag - 1], normalised[lag], normalised[lag + 1]
+    curvature = before - 2.0 * centre + after
+    offset = 0.5 * (before - after) / curvature if curvature < 0.0 else 0.0
+
+    return sample_rate / (lag + offset)
+
+def frequency_to_note(frequency, expected_note=None):
+    """MIDI note for frequency, rejecting octave errors around expected_note"""
+    if frequency is not None and frequency > 0.0:
+        note = int(np.clip(int(np.round(69 + 12.0 * np.log2(frequency / 440.0))), 0, 127))
+
+        if expected_note is None or abs(note - expected_note) <= 12:
+            return note
+
+    return expected_note if expected_note is not None else 60
+
+def find_loop_points(audio):
+    """Loop the last 75%, starting on the first zero crossing after the quarter mark"""
+    length = len(audio)
+    loop_start = length // 4
+    stop = min(loop_start + LOOP_SEARCH, length - 1)
+
+    if stop > loop_start:
+        window = audio[loop_start:stop + 1]
+        crossings = np.flatnonzero(window[:-1] * window[1:] <= 0.0)
+
+        if len(crossings):
+            loop_start += int(crossings[0])
+
+    return loop_start, length
+
+def analyse(audio, sample_rate, expected_note=None):
+    """
+    Trim, normalise and analyse one clip
+
+    Returns (mono float32 audio, metadata dict). Loop points and length are
+    in samples of the returned audio at sample_rate.
+    """
+    audio = trim_silence(to_mono(audio))
+    audio, peak_db = normalize(audio)
+
+    frequency = detect_pitch(audio, sample_rate)
+    loop_start, loop_end = find_loop_points(audio)
+
+    metadata = {
+        "root_note": frequency_to_note(frequency, expected_note),
+        "pitch_hz": round(frequency, 3) if frequency else None,
+        "loop_start": loop_start,
+        "loop_end": loop_end,
+        "peak_db": peak_db,
+        "length": len(audio),
+        "sample_rate": sample_rate,
+    }
+
+    return audio.astype(np.float32), metadata
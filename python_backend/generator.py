@@ -8,15 +8,20 @@ from audiocraft.models import MusicGen
 import tempfile
 import os
 import logging
+import analysis
 
 logger = logging.getLogger(__name__)
 
+class GenerationCancelled(Exception):
+    """Raised from inside generation when its should_stop callback fires"""
+
 class AudioGenerator:
     """
     Wrapper for MusicGen audio generation
     """
     
-    def __init__(self, model_name='facebook/musicgen-small'):
+    def __init__(self, model_name='facebook/musicgen-small', progress_callback=None,
+                 cpu_optimize=None, num_threads=None, device=None):
         """
         Initialize the audio generator
         
@@ -24,65 +29,191 @@ class AudioGenerator:
             model_name: HuggingFace model name
                 - 'facebook/musicgen-small' (300M params, fastest)
                 - 'facebook/musicgen-medium' (1.5B params, better quality)
+            progress_callback: optional callable(stage, fraction) for load progress
+            cpu_optimize: int8-quantize the language model when running on
+                CPU; None means on whenever there is no GPU
+            num_threads: intra-op threads for CPU inference (default: all
+                cores this process may use)
+            device: 'cuda' or 'cpu' (default: GPU if available)
         """
+        report = progress_callback or (lambda stage, fraction: None)
+        
         logger.info(f"Loading model: {model_name}")
+        report("Loading model weights", 0.0)
+        
+        # Use GPU if available. Decided before loading: audiocraft puts the
+        # model on CUDA by default, which would defeat device='cpu'
+        self.device = device or ('cuda' if torch.cuda.is_available() else 'cpu')
+        logger.info(f"Using device: {self.device}")
         
         # Load model
-        self.model = MusicGen.get_pretrained(model_name)
+        self.model = MusicGen.get_pretrained(model_name, device=self.device)
         
         # Set generation parameters
         self.sample_rate = 32000  # MusicGen default
+        self.quantized = False
         
-        # Use GPU if available
-        self.device = 'cuda' if torch.cuda.is_available() else 'cpu'
-        logger.info(f"Using device: {self.device}")
+        # Resample kernels by (source rate, target rate); building one
+        # costs far more than applying it
+        self._resamplers = {}
+        
+        if self.device != 'cuda':
+            self._configure_cpu(report, cpu_optimize is not False, num_threads)
+        
+        report("Model loaded", 1.0)
+    
+    def _configure_cpu(self, report, quantize, num_threads):
+        """
+        CPU inference profile
+        
+        Generation is dominated by the language model's Linear layers, one
+        token step at a time, so dynamic int8 quantization of those layers
+        (weights stored as int8, activations quantized per call) gives most
+        of the speed-up. The EnCodec decoder is convolutional and runs once
+        per clip, so it stays in fp32.
+        """
+        if num_threads is None:
+            num_threads = len(os.sched_getaffinity(0)) if hasattr(os, 'sched_getaffinity') else os.cpu_count()
+        
+        torch.set_num_threads(max(1, num_threads))
+        logger.info(f"CPU inference with {torch.get_num_threads()} threads")
+        
+        self.quantized = False
+        
+        if quantize:
+            report("Quantizing model for CPU", 0.8)
+            self.model.lm = torch.ao.quantization.quantize_dynamic(
+                self.model.lm, {torch.nn.Linear}, dtype=torch.qint8
+            )
+            self.quantized = True
+            logger.info("Language model Linear layers quantized to int8")
+    
+    def warm_up(self, duration=0.5, progress_callback=None):
+        """
+        Run a short throwaway generation so the first real request only
+        pays for inference
+        
+        Args:
+            duration: Length of the warm-up clip in seconds
+            progress_callback: optional callable(fraction) for warm-up progress
+        """
+        if progress_callback is not None:
+            self.model.set_custom_progress_callback(
+                lambda generated, total: progress_callback(min(1.0, generated / max(total, 1)))
+            )
         
-        if self.device == 'cuda':
-            self.model = self.model.to('cuda')
+        try:
+            self.model.set_generation_params(duration=duration)
+            with torch.inference_mode():
+                self.model.generate(["warm up"])
+        finally:
+            self.model.set_custom_progress_callback(None)
     
-    def generate(self, prompt, duration=3.0):
+    def generate(self, prompt, duration=3.0, sample_rate=44100, root_note=None,
+                 seed=None, should_stop=None):
         """
         Generate audio from text prompt
         
         Args:
             prompt: Text description of desired audio
             duration: Length of audio in seconds
+            sample_rate: Rate of the written WAV file
+            root_note: MIDI note the clip should be at, if known
+            seed: Random seed; the same prompt and seed give the same clip
+            should_stop: Optional callable polled at every decoding step;
+                generation raises GenerationCancelled once it returns True
+        
+        Returns:
+            {"wav_path": ..., "analysis": {...}} (see analysis.analyse)
+        """
+        return self.generate_batch([prompt], duration, sample_rate,
+                                   None if root_note is None else [root_note],
+                                   seed=seed, should_stop=should_stop)[0]
+    
+    def generate_batch(self, prompts, duration=3.0, sample_rate=44100, root_notes=None,
+                       seed=None, should_stop=None):
+        """
+        Generate several clips in one batched forward pass
+        
+        MusicGen decodes all prompts of a batch together, so N prompts cost
+        far less than N separate calls (close to one call on a GPU).
+        
+        Each clip is resampled to sample_rate, trimmed, normalized and
+        analysed before it is written, so the plugin can skip that work.
+        
+        Args:
+            prompts: List of text descriptions
+            duration: Length of each clip in seconds
+            sample_rate: Rate of the written WAV files
+            root_notes: Optional list of expected MIDI notes, one per prompt
+            seed: Random seed for the whole batch
+            should_stop: See generate()
         
         Returns:
-            Path to generated WAV file
+            List of {"wav_path", "analysis"} dicts, in prompt order
         """
-        logger.info(f"Generating: '{prompt}' for {duration}s")
+        logger.info(f"Generating {len(prompts)} clip(s) for {duration}s: {prompts}")
         
         # Set duration
         self.model.set_generation_params(duration=duration)
         
+        if seed is not None:
+            torch.manual_seed(seed)
+        
+        if should_stop is not None:
+            def check(generated, total):
+                if should_stop():
+                    raise GenerationCancelled(f"Cancelled after {generated}/{total} steps")
+            
+            self.model.set_custom_progress_callback(check)
+        
         # Generate audio
-        with torch.no_grad():
-            wav = self.model.generate([prompt])  # Returns [1, channels, samples]
+        try:
+            with torch.inference_mode():
+                wavs = self.model.generate(list(prompts))  # Returns [batch, channels, samples]
+        finally:
+            if should_stop is not None:
+                self.model.set_custom_progress_callback(None)
+        
+        # Convert to CPU
+        wavs = wavs.cpu()
+        
+        # Resample straight to the rate the plugin plays at (once for the
+        # whole batch)
+        if self.sample_rate != sample_rate:
+            wavs = self._get_resampler(self.sample_rate, sample_rate)(wavs)
+        
+        results = []
+        for i, wav in enumerate(wavs):
+            expected_note = root_notes[i] if root_notes else None
+            audio, metadata = analysis.analyse(wav.numpy(), sample_rate, expected_note)
+            
+            results.append({
+                "wav_path": self._save(torch.from_numpy(audio).unsqueeze(0), sample_rate),
+                "analysis": metadata
+            })
+        
+        logger.info("Generation complete")
+        return results
+    
+    def _get_resampler(self, orig_freq, new_freq):
+        """Cached torchaudio resampler; the kernel is built on first use only"""
+        key = (orig_freq, new_freq)
         
-        # Convert to CPU and numpy
-        wav = wav.cpu()
+        if key not in self._resamplers:
+            self._resamplers[key] = torchaudio.transforms.Resample(orig_freq=orig_freq, new_freq=new_freq)
         
-        # Save to temporary file
+        return self._resamplers[key]
+    
+    def _save(self, wav, sample_rate):
+        """Write one [channels, samples] clip to a temporary WAV file"""
         temp_file = tempfile.NamedTemporaryFile(delete=False, suffix='.wav', dir='/tmp')
         temp_path = temp_file.name
         temp_file.close()
         
-        # Save as WAV (convert to 44.1kHz for compatibility)
         logger.info(f"Saving to: {temp_path}")
+        torchaudio.save(temp_path, wav, sample_rate)
         
-        # Resample to 44.1kHz if needed
-        if self.sample_rate != 44100:
-            resampler = torchaudio.transforms.Resample(
-                orig_freq=self.sample_rate,
-                new_freq=44100
-            )
-            wav = resampler(wav)
-        
-        # Save
-        torchaudio.save(temp_path, wav[0], 44100)
-        
-        logger.info("Generation complete")
         return temp_path
 
 # Test code
@@ -99,8 +230,10 @@ if __name__ == '__main__':
     
     for prompt in test_prompts:
         print(f"\nGenerating: {prompt}")
-        path = gen.generate(prompt, duration=2.0)
+        result = gen.generate(prompt, duration=2.0)
+        path = result["wav_path"]
         print(f"Saved to: {path}")
+        print(f"Analysis: {result['analysis']}")
         
         # Check file size
         size_mb = os.path.getsize(path) / (1024 * 1024)
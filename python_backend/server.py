@@ -5,10 +5,14 @@ Uses MusicGen model to generate audio from text prompts
 """
 
 from flask import Flask, request, jsonify
+from werkzeug.serving import WSGIRequestHandler
+import argparse
 import os
 import tempfile
+import threading
 import logging
-from generator import AudioGenerator
+from contextlib import contextmanager
+from generator import AudioGenerator, GenerationCancelled
 
 # Configure logging
 logging.basicConfig(level=logging.INFO)
@@ -16,22 +20,155 @@ logger = logging.getLogger(__name__)
 
 app = Flask(__name__)
 
-# Initialize generator (lazy loading)
+# Output rates accepted from the plugin
+DEFAULT_SAMPLE_RATE = 44100
+MIN_SAMPLE_RATE = 8000
+MAX_SAMPLE_RATE = 192000
+
+# Generator instance, loaded at startup (or lazily with --lazy)
 generator = None
+load_lock = threading.Lock()
 
-def get_generator():
-    """Lazy load the audio generator"""
+# Extra AudioGenerator arguments from the command line (CPU profile)
+generator_options = {}
+
+# Loading progress reported through /health
+model_state = {"state": "idle", "stage": "Not loaded", "progress": 0.0, "error": None}
+state_lock = threading.Lock()
+
+def set_model_state(state, stage, progress, error=None):
+    """Update the loading state shown by /health"""
+    with state_lock:
+        model_state.update(state=state, stage=stage, progress=round(progress, 3), error=error)
+
+def load_generator(warmup=True):
+    """Load (and optionally warm up) the model; safe to call from several threads"""
     global generator
+    with load_lock:
+        if generator is not None:
+            return generator
+
+        try:
+            logger.info("Loading AI model...")
+            set_model_state("loading", "Loading model", 0.05)
+            gen = AudioGenerator(
+                progress_callback=lambda stage, fraction: set_model_state("loading", stage, 0.05 + 0.6 * fraction),
+                **generator_options
+            )
+
+            if warmup:
+                # Run one short generation so the first real request does not
+                # pay for kernel selection, allocator growth and cache fills
+                logger.info("Warming up model...")
+                set_model_state("warming_up", "Warming up", 0.65)
+                gen.warm_up(progress_callback=lambda fraction: set_model_state("warming_up", "Warming up", 0.65 + 0.35 * fraction))
+
+            generator = gen
+            set_model_state("ready", "Ready", 1.0)
+            logger.info("Model loaded successfully")
+        except Exception as e:
+            logger.error(f"Model loading failed: {str(e)}", exc_info=True)
+            set_model_state("error", "Model loading failed", 0.0, error=str(e))
+            raise
+
+    return generator
+
+def start_preload(warmup=True, background=True):
+    """Load the model at startup, optionally without blocking the server"""
+    if not background:
+        load_generator(warmup)
+        return
+
+    def run():
+        try:
+            load_generator(warmup)
+        except Exception:
+            pass  # Already logged and reported through /health
+
+    threading.Thread(target=run, name="model-preload", daemon=True).start()
+
+class Busy(Exception):
+    """A low-priority request arrived while the model was in use"""
+
+class GenerationScheduler:
+    """
+    Runs one generation at a time
+
+    Normal requests queue for the model. Low-priority (speculative) requests
+    never queue: they are refused while the model is busy, and a running
+    one is cancelled at its next decoding step as soon as a normal request
+    starts waiting, so user requests never wait behind speculation.
+    """
+
+    def __init__(self):
+        self._condition = threading.Condition()
+        self._busy = False
+        self._normal_waiting = 0
+
+    @contextmanager
+    def slot(self, low_priority=False):
+        with self._condition:
+            if low_priority:
+                if self._busy or self._normal_waiting:
+                    raise Busy("Model is busy")
+            else:
+                self._normal_waiting += 1
+                try:
+                    while self._busy:
+                        self._condition.wait()
+                finally:
+                    self._normal_waiting -= 1
+
+            self._busy = True
+
+        try:
+            yield
+        finally:
+            with self._condition:
+                self._busy = False
+                self._condition.notify_all()
+
+    def normal_request_waiting(self):
+        with self._condition:
+            return self._normal_waiting > 0
+
+scheduler = GenerationScheduler()
+
+def preempted_response(message):
+    """409 for low-priority work that was refused or cancelled"""
+    return jsonify({"error": message, "preempted": True}), 409
+
+def get_generator():
+    """Return the generator, loading it on demand when it was not preloaded"""
     if generator is None:
-        logger.info("Loading AI model...")
-        generator = AudioGenerator()
-        logger.info("Model loaded successfully")
+        return load_generator(warmup=False)
     return generator
 
+def is_loading():
+    with state_lock:
+        return model_state["state"] in ("loading", "warming_up")
+
 @app.route('/health', methods=['GET'])
 def health_check():
-    """Health check endpoint"""
-    return jsonify({"status": "ok", "model_loaded": generator is not None})
+    """
+    Health check endpoint
+
+    "ready" turns true once the model is loaded and warmed up; until then
+    "stage" and "progress" (0..1) describe the loading step in progress.
+    """
+    with state_lock:
+        state = dict(model_state)
+
+    # A lazily loaded server can accept work at any time, it just pays the
+    # load on the first request
+    ready = generator is not None or state["state"] == "idle"
+
+    return jsonify({
+        "status": "ok",
+        "model_loaded": generator is not None,
+        "ready": ready,
+        **state
+    })
 
 @app.route('/generate', methods=['POST'])
 def generate():
@@ -41,13 +178,24 @@ def generate():
     Request JSON:
     {
         "prompt": "deep bass synth",
-        "duration": 3.0
+        "duration": 3.0,
+        "sample_rate": 48000,       (optional, default 44100)
+        "root_note": 60,            (optional)
+        "seed": 1234,               (optional)
+        "priority": "low"           (optional; "low" for speculative work)
     }
     
     Response JSON:
     {
-        "wav_path": "/tmp/generated_xyz.wav"
+        "wav_path": "/tmp/generated_xyz.wav",
+        "analysis": {"root_note": 60, "loop_start": ..., "loop_end": ...,
+                     "peak_db": -0.5, "length": ..., "sample_rate": 48000}
     }
+    
+    The WAV is already trimmed and normalized; "analysis" describes it.
+    
+    Low-priority requests get 409 with "preempted": true when the model is
+    busy or a normal request arrives while they run.
     """
     try:
         # Parse request
@@ -58,28 +206,130 @@ def generate():
         
         prompt = data.get('prompt', '')
         duration = data.get('duration', 3.0)
+        sample_rate = int(data.get('sample_rate', DEFAULT_SAMPLE_RATE))
+        root_note = data.get('root_note')
+        seed = data.get('seed')
+        low_priority = data.get('priority') == 'low'
         
         if not prompt:
             return jsonify({"error": "Prompt cannot be empty"}), 400
         
+        if not MIN_SAMPLE_RATE <= sample_rate <= MAX_SAMPLE_RATE:
+            return jsonify({"error": f"Unsupported sample rate: {sample_rate}"}), 400
+        
+        if generator is None and is_loading():
+            with state_lock:
+                state = dict(model_state)
+            response = jsonify({"error": "Model is still loading", **state})
+            response.headers["Retry-After"] = "1"
+            return response, 503
+
         logger.info(f"Generating audio for prompt: '{prompt}' ({duration}s)")
         
         # Generate audio
+        if low_priority and generator is None:
+            return preempted_response("Model not loaded")
+        
         gen = get_generator()
-        wav_path = gen.generate(prompt, duration)
         
-        logger.info(f"Audio generated: {wav_path}")
+        with scheduler.slot(low_priority):
+            result = gen.generate(prompt, duration, sample_rate,
+                                  None if root_note is None else int(root_note),
+                                  seed=None if seed is None else int(seed),
+                                  should_stop=scheduler.normal_request_waiting if low_priority else None)
+        
+        logger.info(f"Audio generated: {result['wav_path']}")
         
         return jsonify({
-            "wav_path": wav_path,
+            "wav_path": result["wav_path"],
+            "analysis": result["analysis"],
             "prompt": prompt,
-            "duration": duration
+            "duration": duration,
+            "seed": seed
         })
     
+    except (Busy, GenerationCancelled) as e:
+        logger.info(f"Low-priority generation preempted: {e}")
+        return preempted_response(str(e))
+    
     except Exception as e:
         logger.error(f"Generation error: {str(e)}", exc_info=True)
         return jsonify({"error": str(e)}), 500
 
+NOTE_NAMES = ['C', 'C#', 'D', 'D#', 'E', 'F', 'F#', 'G', 'G#', 'A', 'A#', 'B']
+
+def note_name(midi_note):
+    """MIDI note number to a name such as 'C4' (middle C = 60)"""
+    return f"{NOTE_NAMES[midi_note % 12]}{midi_note // 12 - 1}"
+
+@app.route('/generate_batch', methods=['POST'])
+def generate_batch():
+    """
+    Generate one pitched sample per key zone in a single batched call
+    
+    Request JSON:
+    {
+        "prompt": "deep bass synth",
+        "duration": 3.0,
+        "notes": [36, 48, 60, 72],
+        "sample_rate": 48000        (optional, default 44100)
+    }
+    
+    Response JSON:
+    {
+        "wav_paths": ["/tmp/generated_a.wav", ...],
+        "analysis": [{...}, ...],   (one per path, as for /generate)
+        "notes": [36, 48, 60, 72]
+    }
+    """
+    try:
+        data = request.get_json()
+        
+        if not data:
+            return jsonify({"error": "No JSON data provided"}), 400
+        
+        prompt = data.get('prompt', '')
+        duration = data.get('duration', 3.0)
+        notes = [int(n) for n in data.get('notes', [])]
+        sample_rate = int(data.get('sample_rate', DEFAULT_SAMPLE_RATE))
+        
+        if not prompt:
+            return jsonify({"error": "Prompt cannot be empty"}), 400
+        
+        if not notes:
+            return jsonify({"error": "No notes requested"}), 400
+        
+        if not MIN_SAMPLE_RATE <= sample_rate <= MAX_SAMPLE_RATE:
+            return jsonify({"error": f"Unsupported sample rate: {sample_rate}"}), 400
+        
+        if generator is None and is_loading():
+            with state_lock:
+                state = dict(model_state)
+            response = jsonify({"error": "Model is still loading", **state})
+            response.headers["Retry-After"] = "1"
+            return response, 503
+        
+        prompts = [f"{prompt}, single sustained note {note_name(n)}" for n in notes]
+        
+        logger.info(f"Generating {len(notes)} zones for prompt: '{prompt}' ({duration}s)")
+        
+        gen = get_generator()
+        
+        with scheduler.slot():
+            results = gen.generate_batch(prompts, duration, sample_rate, root_notes=notes)
+        
+        return jsonify({
+            "wav_paths": [r["wav_path"] for r in results],
+            "analysis": [r["analysis"] for r in results],
+            "notes": notes,
+            "prompt": prompt,
+            "duration": duration
+        })
+    
+    except Exception as e:
+        logger.error(f"Batch generation error: {str(e)}", exc_info=True)
+        return jsonify({"error": str(e)}), 500
+
 @app.route('/test', methods=['GET'])
 def test():
     """Test endpoint that generates a simple sine wave"""
@@ -101,15 +351,37 @@ def test():
     return jsonify({"wav_path": temp_file.name})
 
 if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="AI Audio Generation Server")
+    parser.add_argument('--lazy', action='store_true',
+                        help="load the model on the first /generate call instead of at startup")
+    parser.add_argument('--no-warmup', action='store_true',
+                        help="skip the warm-up generation after loading")
+    parser.add_argument('--blocking-preload', action='store_true',
+                        help="finish loading before accepting connections")
+    parser.add_argument('--threads', type=int, default=None,
+                        help="intra-op threads for CPU inference (default: all cores)")
+    parser.add_argument('--no-quantize', action='store_true',
+                        help="keep the model in fp32 on CPU instead of int8")
+    args = parser.parse_args()
+
+    generator_options.update(num_threads=args.threads, cpu_optimize=False if args.no_quantize else None)
+
     print("=" * 60)
     print("AI Audio Generation Server")
     print("=" * 60)
     print("Starting server on http://localhost:5000")
     print("Endpoints:")
     print("  POST /generate - Generate audio from prompt")
+    print("  POST /generate_batch - Generate one sample per key zone")
     print("  GET  /health   - Health check")
     print("  GET  /test     - Generate test sine wave")
     print("=" * 60)
     
+    if not args.lazy:
+        start_preload(warmup=not args.no_warmup, background=not args.blocking_preload)
+
+    # HTTP/1.1 lets the plugin keep one connection alive between requests
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+
     # Run server
     app.run(host='0.0.0.0', port=5000, debug=False, threaded=True)
@@ -5,49 +5,53 @@ Use this for testing the plugin without downloading AI models
 """
 
 from flask import Flask, request, jsonify
+from werkzeug.serving import WSGIRequestHandler
 import numpy as np
 import soundfile as sf
 import tempfile
 import logging
+import sys
+import analysis
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
 app = Flask(__name__)
 
-def generate_test_audio(prompt, duration=3.0):
+def generate_test_audio(prompt, duration=3.0, pitch=None, sample_rate=44100):
     """
     Generate test audio based on prompt keywords
     No AI - just simple synthesis for testing
+    
+    pitch optionally overrides the waveform's frequency in Hz
     """
-    sample_rate = 44100
     t = np.linspace(0, duration, int(sample_rate * duration))
     
     # Different waveforms based on prompt
     if 'sine' in prompt.lower() or 'bell' in prompt.lower():
         # Sine wave with decay
-        frequency = 440.0
+        frequency = pitch or 440.0
         audio = np.sin(2 * np.pi * frequency * t)
         envelope = np.exp(-t * 2.0)  # Decay
         audio *= envelope
     
     elif 'saw' in prompt.lower() or 'bass' in prompt.lower():
         # Sawtooth wave
-        frequency = 110.0
+        frequency = pitch or 110.0
         audio = 2 * (t * frequency - np.floor(t * frequency + 0.5))
         envelope = np.exp(-t * 1.0)
         audio *= envelope * 0.5
     
     elif 'square' in prompt.lower() or 'lead' in prompt.lower():
         # Square wave
-        frequency = 220.0
+        frequency = pitch or 220.0
         audio = np.sign(np.sin(2 * np.pi * frequency * t))
         envelope = np.exp(-t * 1.5)
         audio *= envelope * 0.3
     
     else:
         # Default: Sine wave
-        frequency = 440.0
+        frequency = pitch or 440.0
         audio = np.sin(2 * np.pi * frequency * t)
         envelope = np.exp(-t * 2.0)
         audio *= envelope
@@ -57,9 +61,47 @@ def generate_test_audio(prompt, duration=3.0):
     
     return audio.astype(np.float32)
 
+def save_analysed(audio, sample_rate, expected_note=None):
+    """Trim, normalize and analyse like the real backend; returns (path, metadata)"""
+    audio, metadata = analysis.analyse(audio, sample_rate, expected_note)
+    
+    temp_file = tempfile.NamedTemporaryFile(delete=False, suffix='.wav', dir='/tmp')
+    sf.write(temp_file.name, audio, sample_rate)
+    temp_file.close()
+    
+    return temp_file.name, metadata
+
+def check_analysis():
+    """
+    Known tones through the analysis pipeline: every waveform on notes over
+    four octaves must come back with its exact root note and within 5 cents.
+    No expected note is passed, so octave errors are not masked.
+    Returns the number of failures.
+    """
+    sample_rate = 44100
+    failures = 0
+    
+    for prompt in ('sine', 'saw', 'square'):
+        for note in range(36, 85, 4):
+            frequency = 440.0 * 2.0 ** ((note - 69) / 12.0)
+            audio = generate_test_audio(prompt, 1.0, pitch=frequency, sample_rate=sample_rate)
+            _, metadata = analysis.analyse(audio, sample_rate)
+            
+            detected = metadata["pitch_hz"]
+            cents = 1200.0 * np.log2(detected / frequency) if detected else float('inf')
+            passed = metadata["root_note"] == note and abs(cents) <= 5.0
+            
+            if not passed:
+                failures += 1
+            
+            print(f"{'PASS' if passed else 'FAIL'}  {prompt:6s} note {note:3d}: "
+                  f"root {metadata['root_note']:3d}, {cents:+.2f} cents")
+    
+    return failures
+
 @app.route('/health', methods=['GET'])
 def health():
-    return jsonify({"status": "ok", "mode": "test"})
+    return jsonify({"status": "ok", "mode": "test", "ready": True, "state": "ready", "progress": 1.0})
 
 @app.route('/generate', methods=['POST'])
 def generate():
@@ -67,21 +109,59 @@ def generate():
         data = request.get_json()
         prompt = data.get('prompt', 'sine')
         duration = data.get('duration', 3.0)
+        sample_rate = int(data.get('sample_rate', 44100))
+        seed = data.get('seed')
         
-        logger.info(f"Test generation: '{prompt}' ({duration}s)")
+        logger.info(f"Test generation: '{prompt}' ({duration}s, seed {seed})")
         
-        # Generate test audio
-        audio = generate_test_audio(prompt, duration)
+        # Generate test audio; a seed adds its own faint noise so that
+        # variations differ
+        audio = generate_test_audio(prompt, duration, sample_rate=sample_rate)
+        if seed is not None:
+            rng = np.random.default_rng(int(seed))
+            audio = (audio + rng.normal(0.0, 0.01, audio.shape)).astype(np.float32)
+        wav_path, metadata = save_analysed(audio, sample_rate, data.get('root_note'))
         
-        # Save to temp file
-        temp_file = tempfile.NamedTemporaryFile(delete=False, suffix='.wav', dir='/tmp')
-        sf.write(temp_file.name, audio, 44100)
-        temp_file.close()
+        logger.info(f"Test audio saved: {wav_path}")
         
-        logger.info(f"Test audio saved: {temp_file.name}")
+        return jsonify({
+            "wav_path": wav_path,
+            "analysis": metadata,
+            "prompt": prompt,
+            "duration": duration,
+            "seed": seed,
+            "mode": "test"
+        })
+    
+    except Exception as e:
+        logger.error(f"Error: {e}")
+        return jsonify({"error": str(e)}), 500
+
+@app.route('/generate_batch', methods=['POST'])
+def generate_batch():
+    try:
+        data = request.get_json()
+        prompt = data.get('prompt', 'sine')
+        duration = data.get('duration', 3.0)
+        notes = [int(n) for n in data.get('notes', [])]
+        sample_rate = int(data.get('sample_rate', 44100))
+        
+        logger.info(f"Test batch generation: '{prompt}' ({duration}s) notes {notes}")
+        
+        wav_paths = []
+        analyses = []
+        for note in notes:
+            audio = generate_test_audio(prompt, duration, pitch=440.0 * 2.0 ** ((note - 69) / 12.0),
+                                        sample_rate=sample_rate)
+            
+            wav_path, metadata = save_analysed(audio, sample_rate, note)
+            wav_paths.append(wav_path)
+            analyses.append(metadata)
         
         return jsonify({
-            "wav_path": temp_file.name,
+            "wav_paths": wav_paths,
+            "analysis": analyses,
+            "notes": notes,
             "prompt": prompt,
             "duration": duration,
             "mode": "test"
@@ -92,6 +172,12 @@ def generate():
         return jsonify({"error": str(e)}), 500
 
 if __name__ == '__main__':
+    # --check runs the analysis checks instead of serving
+    if '--check' in sys.argv:
+        failures = check_analysis()
+        print(f"{failures} failed")
+        sys.exit(1 if failures else 0)
+    
     print("=" * 60)
     print("TEST SERVER - No AI Models Required")
     print("=" * 60)
@@ -106,4 +192,7 @@ if __name__ == '__main__':
     print("  - 'square' or 'lead' → Square wave")
     print("=" * 60)
     
-    app.run(host='0.0.0.0', port=5000, debug=False)
+    # HTTP/1.1 lets the plugin keep one connection alive between requests
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+
+    app.run(host='0.0.0.0', port=5000, debug=False, threaded=True)